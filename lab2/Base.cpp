@@ -3,7 +3,23 @@
 //
 
 #include "Base.h"
+#include "Directory.h"
 
-Base::Base(const std::string& name): name(name) {}
+Base::Base(const std::string& name, std::shared_ptr<Directory> parent): name(name), parent(parent) {}
 
-std::string Base::getName() const { return name; }
+const std::string& Base::getName() const { return name; }
+
+std::shared_ptr<Directory> Base::getParent() const { return parent.load().lock(); }
+
+// removed from the parent: the node becomes the root of a detached subtree
+void Base::detach() { parent.store(std::weak_ptr<Directory>()); }
+
+std::string Base::getPath() const {
+    std::shared_ptr<Directory> p = getParent();
+    if (!p)     // root
+        return name;
+    std::string path = p->getPath();
+    if (path.back() != '/')
+        path += '/';
+    return path + name;
+}
@@ -5,13 +5,22 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <atomic>
+
+class Directory;
 
 class Base {
     std::string name;
+    std::atomic<std::weak_ptr<Directory>> parent;   // reset when removed from the parent (readers may be walking up)
+    void detach();
+    friend class Directory;
 protected:
-    Base(const std::string& name);
+    Base(const std::string& name, std::shared_ptr<Directory> parent);
 public:
     virtual int mType() const = 0;
     virtual void ls(int indent) const = 0;
-    std::string getName() const;
+    const std::string& getName() const;
+    std::shared_ptr<Directory> getParent() const;
+    std::string getPath() const;
 };
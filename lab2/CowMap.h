@@ -0,0 +1,180 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <memory>
+#include <atomic>
+#include <optional>
+#include <utility>
+#include <cstdint>
+
+// Ordered map for one writer at a time and readers that never lock: a treap whose root is published atomically.
+// With copy-on-write, an update copies the O(log n) nodes on the path to the key instead of modifying them, so a
+// reader keeps the version it loaded with snapshot() for as long as it uses it. Without, nodes are updated in place.
+template<typename K, typename V>
+class CowMap {
+    struct Node;
+    typedef std::shared_ptr<Node> NodePtr;
+
+    struct Node {
+        K key;
+        V value;
+        uint64_t priority;
+        NodePtr left, right;
+    };
+
+    std::atomic<NodePtr> root;
+    Node *current = nullptr;        // the root, for snapshots without refcount
+    uint64_t next_priority = 0;     // writers only
+
+    CowMap(const CowMap& other) = delete;
+    CowMap& operator=(const CowMap& other) = delete;
+
+    static NodePtr own(const NodePtr& t, bool copy) {
+        return copy ? std::make_shared<Node>(*t) : t;
+    }
+
+    // splitmix64 of a counter
+    uint64_t priority() {
+        uint64_t h = next_priority += 0x9e3779b97f4a7c15ULL;
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        return h ^ (h >> 31);
+    }
+
+    // (keys < key, keys > key), key not in t
+    static std::pair<NodePtr, NodePtr> split(const NodePtr& t, const K& key, bool copy) {
+        if (!t)
+            return {nullptr, nullptr};
+        NodePtr n = own(t, copy);
+        if (n->key < key) {
+            auto [l, r] = split(n->right, key, copy);
+            n->right = std::move(l);
+            return {n, r};
+        }
+        auto [l, r] = split(n->left, key, copy);
+        n->left = std::move(r);
+        return {l, n};
+    }
+
+    // keys of a < keys of b
+    static NodePtr merge(const NodePtr& a, const NodePtr& b, bool copy) {
+        if (!a || !b)
+            return a ? a : b;
+        if (a->priority > b->priority) {
+            NodePtr n = own(a, copy);
+            n->right = merge(n->right, b, copy);
+            return n;
+        }
+        NodePtr n = own(b, copy);
+        n->left = merge(a, n->left, copy);
+        return n;
+    }
+
+    // node->key not in t
+    static NodePtr insert(const NodePtr& t, NodePtr node, bool copy) {
+        if (!t || node->priority > t->priority) {
+            std::tie(node->left, node->right) = split(t, node->key, copy);
+            return node;
+        }
+        NodePtr n = own(t, copy);
+        if (node->key < n->key)
+            n->left = insert(n->left, std::move(node), copy);
+        else
+            n->right = insert(n->right, std::move(node), copy);
+        return n;
+    }
+
+    // key in t: value replaced or, if nullopt, node removed
+    static NodePtr replace(const NodePtr& t, const K& key, std::optional<V>& value, bool copy) {
+        if (!(key < t->key) && !(t->key < key)) {
+            if (!value)
+                return merge(t->left, t->right, copy);
+            NodePtr n = own(t, copy);
+            n->value = std::move(*value);
+            return n;
+        }
+        NodePtr n = own(t, copy);
+        if (key < n->key)
+            n->left = replace(n->left, key, value, copy);
+        else
+            n->right = replace(n->right, key, value, copy);
+        return n;
+    }
+
+    static const Node *findNode(const Node *t, const K& key) {
+        while (t && (key < t->key || t->key < key))
+            t = key < t->key ? t->left.get() : t->right.get();
+        return t;
+    }
+
+    // in order, the keys of t starting with prefix
+    template<typename F>
+    static void forEachPrefix(const Node *t, const K& prefix, F& fun) {
+        if (!t)
+            return;
+        bool after = !(t->key < prefix), in = after && t->key.starts_with(prefix);
+        if (after)
+            forEachPrefix(t->left.get(), prefix, fun);
+        if (in)
+            fun(t->key, t->value);
+        if (!after || in)
+            forEachPrefix(t->right.get(), prefix, fun);
+    }
+
+public:
+    // version of the map loaded by a reader
+    class Snapshot {
+        NodePtr root;
+
+    public:
+        explicit Snapshot(NodePtr root): root(std::move(root)) {}
+
+        // value of key, nullptr if missing (valid while the snapshot lives)
+        const V *find(const K& key) const {
+            const Node *n = findNode(root.get(), key);
+            return n ? &n->value : nullptr;
+        }
+
+        // calls fun(key, value) for the keys starting with prefix, in order (string keys)
+        template<typename F>
+        void forEachPrefix(const K& prefix, F fun) const {
+            CowMap::forEachPrefix(root.get(), prefix, fun);
+        }
+    };
+
+    CowMap() = default;
+
+    // shared = false, when there is no writer in other threads: no refcount, but does not keep the version alive
+    Snapshot snapshot(bool shared = true) const {
+        return Snapshot(shared ? root.load() : NodePtr(NodePtr(), current));
+    }
+
+    // Calls fun(std::optional<V>&) with the value of key (nullopt if missing) to update it: the key is removed if
+    // left nullopt. One writer at a time, copying the path to the key if copy_on_write (readers are running).
+    template<typename F>
+    void update(const K& key, F fun, bool copy_on_write) {
+        NodePtr t = root.load();
+        const Node *n = findNode(t.get(), key);
+        std::optional<V> value;
+        if (n)
+            value = n->value;
+        fun(value);
+        if (n)
+            t = replace(t, key, value, copy_on_write);
+        else if (value)
+            t = insert(t, std::make_shared<Node>(Node{key, std::move(*value), priority(), nullptr, nullptr}),
+                       copy_on_write);
+        else
+            return;
+        current = t.get();
+        root.store(std::move(t));
+    }
+
+    void clear() {
+        current = nullptr;
+        root.store(nullptr);
+    }
+};
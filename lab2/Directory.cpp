@@ -3,11 +3,27 @@
 //
 
 #include "Directory.h"
+#include "TreeWriter.h"
 #include <iostream>
+#include <algorithm>
+#include <mutex>
+#include <queue>
+#include <bit>
+#include <fnmatch.h>
 
 std::shared_ptr<Directory> Directory::root{nullptr};
+bool Directory::concurrent{false};
+std::mutex Directory::m_writers;
+CowMap<std::string, std::weak_ptr<Base>> Directory::names;
+CowMap<std::string, std::weak_ptr<Base>> Directory::reversed_names;
+std::atomic<std::size_t> Directory::n_entries{0};
+CowMap<std::size_t, std::vector<std::pair<std::string, std::weak_ptr<Base>>>> Directory::paths;
+std::atomic<bool> Directory::paths_enabled{false};
 
-Directory::Directory(const std::string& name, std::shared_ptr<Directory> parent): Base(name), parent(parent) {}
+Directory::Directory(const std::string& name, std::shared_ptr<Directory> parent): Base(name, parent),
+        children(std::make_shared<Children>()), digest(0) {
+    current = children.load().get();
+}
 
 std::shared_ptr<Directory> makeDirectory(const std::string& name, std::shared_ptr<Directory> parent) {
     std::shared_ptr<Directory> dir{new Directory(name, parent)};
@@ -16,31 +32,65 @@ std::shared_ptr<Directory> makeDirectory(const std::string& name, std::shared_pt
 }
 
 std::shared_ptr<Directory> Directory::getRoot() {
-    if (!root)
-        root = makeDirectory("/", std::shared_ptr<Directory>(nullptr));
+    static std::once_flag root_created;
+    std::call_once(root_created, []() { root = makeDirectory("/", std::shared_ptr<Directory>(nullptr)); });
     return root;
 }
 
+void Directory::setConcurrent(bool enabled) {
+    concurrent = enabled;
+}
+
+std::unique_lock<std::mutex> Directory::lockWriters() {
+    return concurrent ? std::unique_lock(m_writers) : std::unique_lock<std::mutex>();
+}
+
+std::shared_ptr<const Directory::Children> Directory::snapshot() const {
+    return children.load();
+}
+
 int Directory::mType() const { return Directory::TYPE; }
 
 void Directory::ls(int indent) const {
-    // name
-    for (int i=0; i<indent; i++)
-        std::cout << " ";
-    std::cout << "[+] " << getName() << std::endl;
+    TreeWriter writer(std::cout, TreeFormat::TEXT, indent);
+    traverse(writer);
+}
 
-    // recursion
-    for (auto &c : children)
-        c.second->ls(indent+4);
+void Directory::traverse(TreeVisitor& visitor, bool sorted, int max_depth) const {
+    traverse(visitor, sorted, max_depth, 0);
+}
+
+void Directory::traverse(TreeVisitor& visitor, bool sorted, int max_depth, int depth) const {
+    visitor.visitDirectory(*this, depth);
+    if (depth != max_depth) {
+        std::shared_ptr<const Children> table = snapshot();
+        std::vector<const Base *> entries;
+        entries.reserve(table->size());
+        for (const auto& c : *table)
+            entries.push_back(c.second.get());
+        if (sorted)
+            std::sort(entries.begin(), entries.end(), [](const Base *a, const Base *b) {
+                return a->getName() < b->getName();
+            });
+        for (const Base *e : entries) {
+            if (e->mType() == TYPE)
+                static_cast<const Directory *>(e)->traverse(visitor, sorted, max_depth, depth+1);
+            else
+                visitor.visitFile(static_cast<const File&>(*e), depth+1);
+        }
+    }
+    visitor.leaveDirectory(*this, depth);
 }
 
 std::shared_ptr<Base> Directory::get(const std::string& name) const {
     if (name == ".")
         return self.lock();
     if (name == "..")
-        return parent.lock();
-    auto c = children.find(name);
-    return c != children.end() ? c->second : nullptr;
+        return getParent();
+    std::shared_ptr<const Children> snap = concurrent ? snapshot() : nullptr;     // no refcount bump if not needed
+    const Children& table = snap ? *snap : *current;
+    auto c = table.find(name);
+    return c != table.end() ? c->second : nullptr;
 }
 
 std::shared_ptr<Directory> Directory::getDir(const std::string &name) const {
@@ -52,24 +102,357 @@ std::shared_ptr<File> Directory::getFile(const std::string &name) const {
 }
 
 std::shared_ptr<Directory> Directory::addDirectory(const std::string& name) {
-    if (name == "." || name == ".." || children.find(name) != children.end())
+    if (name == "." || name == "..")
+        return nullptr;
+    std::unique_lock lock = lockWriters();
+    if (snapshot()->contains(name))
         return nullptr;
     auto child = makeDirectory(name, this->self.lock());
-    children.insert(std::make_pair(name, child));
+    updateChildren([&](Children& table) { table.insert(std::make_pair(name, child)); });
+    if (attached())
+        indexAdd(child);
+    updateDigest(0, entryDigest(*child));
     return child;
 }
 
 std::shared_ptr<File> Directory::addFile(const std::string &name, uintmax_t size) {
-    if (name == "." || name == ".." || children.find(name) != children.end())
+    if (name == "." || name == "..")
+        return nullptr;
+    std::unique_lock lock = lockWriters();
+    if (snapshot()->contains(name))
         return nullptr;
-    auto child = File::makeFile(name, size);
-    children.insert(std::make_pair(name, child));
+    auto child = File::makeFile(name, size, this->self.lock());
+    updateChildren([&](Children& table) { table.insert(std::make_pair(name, child)); });
+    if (attached())
+        indexAdd(child);
+    updateDigest(0, entryDigest(*child));
     return child;
 }
 
 bool Directory::remove(const std::string &name) {
-    if (name == "." || name == ".." || children.find(name) == children.end())
+    if (name == "." || name == "..")
         return false;
-    children.erase(name);
+    std::unique_lock lock = lockWriters();
+    std::shared_ptr<const Children> table = snapshot();
+    auto c = table->find(name);
+    if (c == table->end())
+        return false;
+    std::shared_ptr<Base> child = c->second;     // c is invalidated by the update if not in concurrent mode
+    if (attached())
+        indexRemove(child, paths_enabled ? child->getPath() : "");
+    updateDigest(entryDigest(*child), 0);
+    updateChildren([&name](Children& entries) { entries.erase(name); });
+    child->detach();        // changes of the subtree, if still held, no longer reach this directory
     return true;
 }
+
+// Whether this directory is in the tree, i.e. reaches the root: the subtrees removed but still held by the callers
+// are detached, their nodes are not indexed and their digests are not added to the tree.
+bool Directory::attached() const {
+    std::shared_ptr<const Directory> dir = self.lock();
+    while (dir && dir != root)
+        dir = dir->getParent();
+    return dir != nullptr;
+}
+
+std::string Directory::indexKey(std::string name, const Base *node) {
+    name += '\0';
+    name.append(reinterpret_cast<const char *>(&node), sizeof(node));
+    return name;
+}
+
+void Directory::indexAdd(const std::shared_ptr<Base>& node) {
+    const std::string& name = node->getName();
+    auto add = [&node](std::optional<std::weak_ptr<Base>>& entry) { entry = node; };
+    names.update(indexKey(name, node.get()), add, concurrent);
+    reversed_names.update(indexKey(std::string(name.rbegin(), name.rend()), node.get()), add, concurrent);
+    n_entries++;
+
+    if (paths_enabled) {
+        std::string path = node->getPath();
+        paths.update(std::hash<std::string>{}(path), [&](auto& entries) {
+            if (!entries)
+                entries.emplace();
+            entries->emplace_back(std::move(path), node);
+        }, concurrent);
+    }
+}
+
+void Directory::indexRemove(const std::shared_ptr<Base>& node, const std::string& path) {
+    // subtree first
+    if (node->mType() == TYPE) {
+        std::shared_ptr<const Children> table = static_cast<const Directory&>(*node).snapshot();
+        for (const auto& c : *table)
+            indexRemove(c.second, paths_enabled ? path + "/" + c.first : "");
+    }
+
+    if (paths_enabled) {
+        paths.update(std::hash<std::string>{}(path), [&path](auto& entries) {
+            if (!entries)
+                return;
+            std::erase_if(*entries, [&path](const auto& e) { return e.first == path; });
+            if (entries->empty())
+                entries.reset();
+        }, concurrent);
+    }
+
+    const std::string& name = node->getName();
+    bool removed = false;
+    names.update(indexKey(name, node.get()), [&removed](std::optional<std::weak_ptr<Base>>& entry) {
+        removed = entry.has_value();
+        entry.reset();
+    }, concurrent);
+    reversed_names.update(indexKey(std::string(name.rbegin(), name.rend()), node.get()),
+                          [](std::optional<std::weak_ptr<Base>>& entry) { entry.reset(); }, concurrent);
+    if (removed)
+        n_entries--;
+}
+
+std::vector<std::shared_ptr<Base>> Directory::find(const std::string& pattern) {
+    std::vector<std::shared_ptr<Base>> result;
+    auto add_node = [&result](const std::string&, const std::weak_ptr<Base>& entry) {
+        if (auto node = entry.lock())
+            result.push_back(node);
+    };
+
+    // classify pattern: literal, "prefix*", "*suffix" are answered by the index
+    const char *special = "*?[\\";
+    std::size_t first = pattern.find_first_of(special);
+    if (first == std::string::npos) {
+        names.snapshot(concurrent).forEachPrefix(pattern + '\0', add_node);
+        return result;
+    }
+    if (first == pattern.size()-1 && pattern[first] == '*') {
+        names.snapshot(concurrent).forEachPrefix(pattern.substr(0, first), add_node);
+        return result;
+    }
+    if (first == 0 && pattern[0] == '*' && pattern.find_first_of(special, 1) == std::string::npos) {
+        std::string reversed_suffix(pattern.rbegin(), pattern.rend()-1);
+        reversed_names.snapshot(concurrent).forEachPrefix(reversed_suffix, add_node);
+        return result;
+    }
+
+    // generic glob => traversal, parallel only if the tree is large enough to pay for starting the threads
+    std::mutex m_result;
+    std::shared_ptr<Directory> dir = getRoot();
+    unsigned int n_threads = n_entries < parallel_find_entries ? 1 : 0;
+    dir->parallelVisit([&](unsigned int, const Directory&, const std::shared_ptr<Base>& node) {
+        if (fnmatch(pattern.c_str(), node->getName().c_str(), 0) == 0) {
+            std::unique_lock lg = n_threads == 1 ? std::unique_lock<std::mutex>() : std::unique_lock(m_result);
+            result.push_back(node);
+        }
+    }, n_threads);
+    return result;
+}
+
+void Directory::pathIndexBuild(const std::shared_ptr<Base>& node, const std::string& path) {
+    paths.update(std::hash<std::string>{}(path), [&](auto& entries) {
+        if (!entries)
+            entries.emplace();
+        entries->emplace_back(path, node);
+    }, concurrent);
+    if (node->mType() == TYPE) {
+        std::shared_ptr<const Children> table = static_cast<const Directory&>(*node).snapshot();
+        for (const auto& c : *table)
+            pathIndexBuild(c.second, (path == "/" ? "" : path) + "/" + c.first);
+    }
+}
+
+void Directory::setPathIndex(bool enabled) {
+    std::unique_lock lock = lockWriters();
+    if (enabled == paths_enabled)
+        return;
+    // readers use the index only once complete
+    paths_enabled = false;
+    paths.clear();
+    if (enabled) {
+        pathIndexBuild(getRoot(), "/");
+        paths_enabled = true;
+    }
+}
+
+std::string Directory::canonicalPath(const std::string& path) {
+    std::string canonical;
+    std::size_t begin = 0, end;
+    while (begin < path.size()) {
+        end = path.find('/', begin);
+        if (end == std::string::npos)
+            end = path.size();
+        std::string_view name(path.data() + begin, end - begin);
+        if (name == "..") {
+            std::size_t last = canonical.rfind('/');
+            canonical.resize(last == std::string::npos ? 0 : last);
+        } else if (!name.empty() && name != ".") {
+            canonical += '/';
+            canonical += name;
+        }
+        begin = end + 1;
+    }
+    return canonical.empty() ? "/" : canonical;
+}
+
+std::shared_ptr<Base> Directory::lookup(const std::string& path) {
+    if (path.empty() || path[0] != '/')
+        return nullptr;
+
+    // "." and ".." are resolved on the path, before the index probe or the walk, so that both give the same node
+    bool canonical = path.size() == 1 || path.back() != '/';
+    for (std::size_t i=0; canonical && i<path.size()-1; i++)
+        canonical = path[i] != '/' || (path[i+1] != '/' && path[i+1] != '.');
+    std::string canonical_path = canonical ? std::string() : canonicalPath(path);
+    const std::string& p = canonical ? path : canonical_path;
+
+    // path index
+    if (paths_enabled) {
+        auto index = paths.snapshot(concurrent);
+        if (const auto *entries = index.find(std::hash<std::string>{}(p)))
+            for (const auto& [entry_path, node] : *entries)
+                if (entry_path == p)
+                    return node.lock();
+        return nullptr;
+    }
+
+    // walk one component at a time
+    std::shared_ptr<Base> node = getRoot();
+    std::size_t begin = 1, end;
+    while (node && begin < p.size()) {
+        end = p.find('/', begin);
+        if (end == std::string::npos)
+            end = p.size();
+        if (node->mType() != TYPE)
+            return nullptr;
+        node = static_cast<const Directory&>(*node).get(p.substr(begin, end - begin));
+        begin = end + 1;
+    }
+    return node;
+}
+
+uint64_t Directory::entryDigest(const std::string& name, int type, uint64_t value) {
+    uint64_t h = std::hash<std::string>{}(name) * 0x9e3779b97f4a7c15ULL;
+    h ^= value;
+    h ^= h >> 33;
+    h *= type == TYPE ? 0xff51afd7ed558ccdULL : 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t Directory::entryDigest(const Base& node) {
+    if (node.mType() == TYPE)
+        return entryDigest(node.getName(), TYPE, static_cast<const Directory&>(node).digest);
+    return entryDigest(node.getName(), node.mType(), static_cast<const File&>(node).getSize());
+}
+
+void Directory::updateDigest(uint64_t old_entry, uint64_t new_entry) {
+    std::shared_ptr<Directory> dir = self.lock();
+    uint64_t delta = new_entry - old_entry;
+    while (dir && delta) {
+        // the entry of dir in its parent changes as well
+        uint64_t old_dir_entry = entryDigest(*dir);
+        dir->digest += delta;
+        delta = entryDigest(*dir) - old_dir_entry;
+        dir = dir->getParent();
+    }
+}
+
+uint64_t Directory::getDigest() const { return digest; }
+
+std::vector<DiffEntry> Directory::diff(const std::shared_ptr<Directory>& other) const {
+    std::vector<DiffEntry> diffs;
+    diffRecursive(*this, *other, "", diffs);
+    std::sort(diffs.begin(), diffs.end(), [](const DiffEntry& a, const DiffEntry& b) { return a.path < b.path; });
+    return diffs;
+}
+
+void Directory::diffRecursive(const Directory& before, const Directory& after, const std::string& path,
+                              std::vector<DiffEntry>& diffs) {
+    if (before.digest == after.digest)     // identical subtrees
+        return;
+    std::shared_ptr<const Children> before_children = before.snapshot(), after_children = after.snapshot();
+
+    auto entry = [](DiffEntry::Change change, const std::string& path, const Base& node) {
+        bool directory = node.mType() == TYPE;
+        uintmax_t size = directory ? 0 : static_cast<const File&>(node).getSize();
+        return DiffEntry{change, path, directory, change == DiffEntry::ADDED ? 0 : size,
+                         change == DiffEntry::REMOVED ? 0 : size};
+    };
+
+    for (const auto& b : *before_children) {
+        std::string child_path = path + "/" + b.first;
+        auto a = after_children->find(b.first);
+        if (a == after_children->end()) {
+            diffs.push_back(entry(DiffEntry::REMOVED, child_path, *b.second));
+        } else if (a->second->mType() != b.second->mType()) {
+            diffs.push_back(entry(DiffEntry::REMOVED, child_path, *b.second));
+            diffs.push_back(entry(DiffEntry::ADDED, child_path, *a->second));
+        } else if (b.second->mType() == TYPE) {
+            diffRecursive(static_cast<const Directory&>(*b.second), static_cast<const Directory&>(*a->second),
+                          child_path, diffs);
+        } else {
+            uintmax_t old_size = static_cast<const File&>(*b.second).getSize();
+            uintmax_t new_size = static_cast<const File&>(*a->second).getSize();
+            if (old_size != new_size)
+                diffs.push_back(DiffEntry{DiffEntry::RESIZED, child_path, false, old_size, new_size});
+        }
+    }
+    for (const auto& a : *after_children)
+        if (!before_children->contains(a.first))
+            diffs.push_back(entry(DiffEntry::ADDED, path + "/" + a.first, *a.second));
+}
+
+SizeStats Directory::sizeStats(std::size_t top_n, unsigned int n_threads) const {
+    typedef std::pair<uintmax_t, std::shared_ptr<Base>> Entry;
+    auto greater = [](const Entry& a, const Entry& b) { return a.first > b.first; };
+    typedef std::priority_queue<Entry, std::vector<Entry>, decltype(greater)> MinHeap;
+
+    // per-thread partial results: bounded min-heap of the largest files and histogram
+    struct alignas(64) Partial {
+        SizeStats stats;
+        MinHeap heap;
+    };
+    if (n_threads == 0)
+        n_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Partial> partials(n_threads, Partial{SizeStats{}, MinHeap(greater)});
+
+    parallelVisit([&partials, top_n](unsigned int thread_id, const Directory&, const std::shared_ptr<Base>& node) {
+        if (node->mType() == TYPE)
+            return;
+        Partial& p = partials[thread_id];
+        uintmax_t size = static_cast<const File&>(*node).getSize();
+        p.stats.files++;
+        p.stats.bytes += size;
+        p.stats.histogram[std::bit_width(size)]++;
+        if (p.heap.size() < top_n) {
+            p.heap.emplace(size, node);
+        } else if (top_n > 0 && size > p.heap.top().first) {
+            p.heap.pop();
+            p.heap.emplace(size, node);
+        }
+    }, n_threads);
+
+    // merge
+    SizeStats stats;
+    MinHeap heap(greater);
+    for (auto& p : partials) {
+        stats.files += p.stats.files;
+        stats.bytes += p.stats.bytes;
+        for (std::size_t i=0; i<stats.histogram.size(); i++)
+            stats.histogram[i] += p.stats.histogram[i];
+        for (; !p.heap.empty(); p.heap.pop()) {
+            heap.push(p.heap.top());
+            if (heap.size() > top_n)
+                heap.pop();
+        }
+    }
+    stats.largest.resize(heap.size());
+    for (std::size_t i=heap.size(); i>0; i--, heap.pop())
+        stats.largest[i-1] = std::static_pointer_cast<File>(heap.top().second);
+    return stats;
+}
+
+std::vector<std::shared_ptr<File>> Directory::largestFiles(std::size_t n, unsigned int n_threads) const {
+    return sizeStats(n, n_threads).largest;
+}
+
+std::array<uintmax_t, 65> Directory::sizeHistogram(unsigned int n_threads) const {
+    return sizeStats(0, n_threads).histogram;
+}
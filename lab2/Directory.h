@@ -6,27 +6,114 @@
 
 #include "Base.h"
 #include "File.h"
+#include "TreeVisitor.h"
+#include "CowMap.h"
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <array>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+
+// difference between two trees, path is relative to the compared directories
+struct DiffEntry {
+    enum Change { ADDED, REMOVED, RESIZED };
+    Change change;
+    std::string path;
+    bool directory;
+    uintmax_t old_size, new_size;
+};
+
+// size statistics of the files below a directory
+struct SizeStats {
+    uintmax_t files = 0, bytes = 0;
+    std::vector<std::shared_ptr<File>> largest;     // largest first
+    std::array<uintmax_t, 65> histogram{};          // [0]: empty files, [i]: files with size in [2^(i-1), 2^i)
+};
 
 class Directory: public Base {
-    std::weak_ptr<Directory> parent;
+    typedef std::unordered_map<std::string, std::shared_ptr<Base>> Children;
+
     std::weak_ptr<Directory> self;
-    std::unordered_map<std::string, std::shared_ptr<Base>> children;
+    std::atomic<std::shared_ptr<Children>> children;    // in concurrent mode: copy-on-write, readers use snapshots
+    Children *current;      // the table in children, used directly (no refcount) when not in concurrent mode
+    std::atomic<uint64_t> digest;   // sum of the digests of the children entries, identical subtrees have identical digests
     static std::shared_ptr<Directory> root;
     static const int TYPE = 0;
 
+    // concurrent mode: writers are serialized, readers never lock the tree nor the indexes
+    static bool concurrent;
+    static std::mutex m_writers;
+
+    // name index of the whole tree (root excluded), one entry per node keyed by name + '\0' + address of the node,
+    // plus the same by reversed name for suffix queries
+    static CowMap<std::string, std::weak_ptr<Base>> names;
+    static CowMap<std::string, std::weak_ptr<Base>> reversed_names;
+    static std::atomic<std::size_t> n_entries;
+    static constexpr std::size_t parallel_find_entries = 1 << 14;     // below, find() visits the tree in one thread
+
+    // optional path index: hash of the canonical absolute path -> (path, node), with the colliding paths
+    static CowMap<std::size_t, std::vector<std::pair<std::string, std::weak_ptr<Base>>>> paths;
+    static std::atomic<bool> paths_enabled;
+
     bool check_name(const std::string &name) const;
     Directory(const std::string& name, std::shared_ptr<Directory> parent);
     friend std::shared_ptr<Directory> makeDirectory(const std::string& name, std::shared_ptr<Directory> parent);
 
+    static std::unique_lock<std::mutex> lockWriters();
+    std::shared_ptr<const Children> snapshot() const;
+
+    // applies fun to the children, in place or (concurrent mode) on a copy published atomically
+    template<typename F>
+    void updateChildren(F fun) {
+        if (concurrent) {
+            std::shared_ptr<Children> table = std::make_shared<Children>(*current);
+            fun(*table);
+            current = table.get();
+            children.store(std::move(table));
+        } else {
+            fun(*current);
+        }
+    }
+
+    static std::string indexKey(std::string name, const Base *node);
+    static void indexAdd(const std::shared_ptr<Base>& node);
+    static void indexRemove(const std::shared_ptr<Base>& node, const std::string& path);   // node and its subtree
+    static void pathIndexBuild(const std::shared_ptr<Base>& node, const std::string& path);
+    static std::string canonicalPath(const std::string& path);
+    bool attached() const;
+
+    static uint64_t entryDigest(const std::string& name, int type, uint64_t value);
+    static uint64_t entryDigest(const Base& node);
+    void updateDigest(uint64_t old_entry, uint64_t new_entry);
+    void traverse(TreeVisitor& visitor, bool sorted, int max_depth, int depth) const;
+    static void diffRecursive(const Directory& before, const Directory& after, const std::string& path,
+                              std::vector<DiffEntry>& diffs);
+
+    template<typename F>
+    static void visitRecursive(const Directory& dir, F& fun, unsigned int thread_id) {
+        std::shared_ptr<const Children> table = dir.snapshot();
+        for (const auto& c : *table) {
+            fun(thread_id, dir, c.second);
+            if (c.second->mType() == TYPE)
+                visitRecursive(static_cast<const Directory&>(*c.second), fun, thread_id);
+        }
+    }
+
 public:
     static std::shared_ptr<Directory> getRoot();
 
+    // enable/disable concurrent readers and writers (to be called while no other thread uses the tree)
+    static void setConcurrent(bool enabled);
+
     int mType() const override;
     void ls(int indent) const override;
 
+    // visits this directory and the entries below it up to max_depth (-1 = no limit), optionally sorted by name
+    void traverse(TreeVisitor& visitor, bool sorted = false, int max_depth = -1) const;
+
     std::shared_ptr<Base> get(const std::string& name) const;
     std::shared_ptr<Directory> getDir(const std::string& name) const;
     std::shared_ptr<File> getFile(const std::string& name) const;
@@ -35,4 +122,63 @@ public:
     std::shared_ptr<File> addFile(const std::string& name, uintmax_t size);
 
     bool remove(const std::string& name);
+
+    // resolve an absolute path, with one hash probe if the path index is enabled. "." and ".." are allowed and resolved
+    // lexically, as in std::filesystem::path::lexically_normal(): "/a/missing/.." is "/a" even if a has no missing
+    static std::shared_ptr<Base> lookup(const std::string& path);
+    static void setPathIndex(bool enabled);
+
+    uint64_t getDigest() const;
+
+    // added, removed and resized entries from this tree to other (identical subtrees are skipped by digest)
+    std::vector<DiffEntry> diff(const std::shared_ptr<Directory>& other) const;
+
+    // single parallel traversal computing the top_n largest files and the log2 size histogram
+    SizeStats sizeStats(std::size_t top_n, unsigned int n_threads = 0) const;
+    std::vector<std::shared_ptr<File>> largestFiles(std::size_t n, unsigned int n_threads = 0) const;
+    std::array<uintmax_t, 65> sizeHistogram(unsigned int n_threads = 0) const;
+
+    // glob search (*, ?, [...]) by name over the whole tree; exact, prefix and suffix patterns use the index
+    static std::vector<std::shared_ptr<Base>> find(const std::string& pattern);
+
+    // calls fun(thread_id, parent, child) for every entry below this directory, with subtrees split among
+    // n_threads threads (0 = hardware concurrency); thread_id < n_threads can index per-thread state
+    template<typename F>
+    void parallelVisit(F fun, unsigned int n_threads = 0) const {
+        if (n_threads == 0)
+            n_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        if (n_threads == 1) {
+            visitRecursive(*this, fun, 0);
+            return;
+        }
+
+        // expand the first levels breadth-first, until there are enough subtrees to balance the threads
+        std::vector<std::shared_ptr<const Directory>> frontier{self.lock()}, next;
+        while (!frontier.empty() && frontier.size() < 4*n_threads) {
+            for (const auto& dir : frontier) {
+                std::shared_ptr<const Children> table = dir->snapshot();
+                for (const auto& c : *table) {
+                    fun(0, *dir, c.second);
+                    if (c.second->mType() == TYPE)
+                        next.push_back(std::static_pointer_cast<const Directory>(c.second));
+                }
+            }
+            frontier.swap(next);
+            next.clear();
+        }
+
+        // visit the subtrees in parallel, each thread picks the next unvisited one
+        std::atomic<std::size_t> next_subtree{0};
+        std::vector<std::thread> threads;
+        for (unsigned int i=0; i<n_threads; i++) {
+            threads.emplace_back([&, i]() {
+                std::size_t j;
+                while ((j = next_subtree++) < frontier.size())
+                    visitRecursive(*frontier[j], fun, i);
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+    }
 };
@@ -0,0 +1,272 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#include "DuplicateFinder.h"
+#include "Jobs.h"
+#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <bit>
+#include <cstring>
+#include <climits>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+    // window of a file mapped in memory, waiting to be hashed
+    struct Window {
+        std::size_t file;
+        std::size_t index;
+        void *map;
+        std::size_t length;
+    };
+
+    uint64_t fmix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    // 128-bit hash of a window (MurmurHash3 x64 128 body), the seed is the position of the window in the file
+    std::pair<uint64_t, uint64_t> hash_window(const char *data, std::size_t length, uint64_t seed) {
+        const uint64_t c1 = 0x87c37b91114253d5ULL, c2 = 0x4cf5ad432745937fULL;
+        uint64_t h1 = fmix(seed + 1), h2 = h1, k1, k2;
+        std::size_t i = 0;
+        for (; i + 2*sizeof(k1) <= length; i += 2*sizeof(k1)) {
+            std::memcpy(&k1, data + i, sizeof(k1));
+            std::memcpy(&k2, data + i + sizeof(k1), sizeof(k2));
+            h1 ^= std::rotl(k1 * c1, 31) * c2;
+            h1 = (std::rotl(h1, 27) + h2) * 5 + 0x52dce729;
+            h2 ^= std::rotl(k2 * c2, 33) * c1;
+            h2 = (std::rotl(h2, 31) + h1) * 5 + 0x38495ab5;
+        }
+        std::size_t tail = length - i;
+        k1 = k2 = 0;
+        std::memcpy(&k1, data + i, std::min(tail, sizeof(k1)));
+        if (tail > sizeof(k1))
+            std::memcpy(&k2, data + i + sizeof(k1), tail - sizeof(k1));
+        h1 ^= std::rotl(k1 * c1, 31) * c2;
+        h2 ^= std::rotl(k2 * c2, 33) * c1;
+        h1 ^= length;
+        h2 ^= length;
+        h1 += h2;
+        h2 += h1;
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+        h1 += h2;
+        return {h1, h2 + h1};
+    }
+
+    // reads exactly length bytes, false on error or end of file
+    bool read_fully(int fd, char *buffer, std::size_t length) {
+        while (length > 0) {
+            ssize_t n = ::read(fd, buffer, length);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            buffer += n;
+            length -= n;
+        }
+        return true;
+    }
+
+    // true if the first size bytes of the files are equal, false if they differ or cannot be read
+    bool same_content(const std::string& path_a, const std::string& path_b, uintmax_t size,
+                      std::vector<char>& buffer_a, std::vector<char>& buffer_b) {
+        int fd_a = ::open(path_a.c_str(), O_RDONLY), fd_b = ::open(path_b.c_str(), O_RDONLY);
+        bool same = fd_a >= 0 && fd_b >= 0;
+        if (same) {
+            ::posix_fadvise(fd_a, 0, size, POSIX_FADV_SEQUENTIAL);
+            ::posix_fadvise(fd_b, 0, size, POSIX_FADV_SEQUENTIAL);
+        }
+        for (uintmax_t offset = 0; same && offset < size; offset += buffer_a.size()) {
+            std::size_t n = std::min<uintmax_t>(buffer_a.size(), size - offset);
+            same = read_fully(fd_a, buffer_a.data(), n) && read_fully(fd_b, buffer_b.data(), n) &&
+                   std::memcmp(buffer_a.data(), buffer_b.data(), n) == 0;
+        }
+        if (fd_a >= 0) ::close(fd_a);
+        if (fd_b >= 0) ::close(fd_b);
+        return same;
+    }
+}
+
+DuplicateFinder::DuplicateFinder(unsigned int n_readers, unsigned int n_hashers, std::size_t window_size,
+                                 unsigned int max_windows, bool verify_content) :
+        n_readers(std::max(1u, n_readers)),
+        n_hashers(n_hashers ? n_hashers : std::max(1u, std::thread::hardware_concurrency())),
+        max_windows(std::max(1u, max_windows)),
+        verify_content(verify_content) {
+    // windows must start at page boundaries
+    std::size_t page_size = ::sysconf(_SC_PAGESIZE);
+    this->window_size = std::max(page_size, window_size / page_size * page_size);
+}
+
+std::vector<std::optional<DuplicateFinder::Hash>> DuplicateFinder::hash(const std::vector<std::shared_ptr<File>>& files,
+                                                                       uintmax_t limit) const {
+    std::unique_ptr<std::atomic<uint64_t>[]> sums(new std::atomic<uint64_t>[2*files.size()]{});   // two per file
+    std::unique_ptr<std::atomic<bool>[]> failed(new std::atomic<bool>[files.size()]{});
+    Jobs<Window> windows(max_windows);
+    std::atomic<std::size_t> next_file{0};
+
+    // readers: map windows and fault them in
+    auto read = [&]() {
+        std::size_t f;
+        while ((f = next_file++) < files.size()) {
+            uintmax_t size = files[f]->getSize();
+            int fd = ::open(files[f]->getPath().c_str(), O_RDONLY);
+            struct stat st;
+            if (fd < 0 || ::fstat(fd, &st) < 0 || static_cast<uintmax_t>(st.st_size) != size) {   // changed on disk
+                failed[f] = true;
+                if (fd >= 0) ::close(fd);
+                continue;
+            }
+            uintmax_t length = std::min(size, limit);
+            ::posix_fadvise(fd, 0, length, POSIX_FADV_SEQUENTIAL);
+            for (std::size_t i=0; i*window_size < length; i++) {
+                std::size_t offset = i*window_size, n = std::min<uintmax_t>(window_size, length - offset);
+                void *map = ::mmap(nullptr, n, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, offset);
+                if (map == MAP_FAILED) {
+                    failed[f] = true;
+                    break;
+                }
+                windows.put(Window{f, i, map, n});
+            }
+            ::close(fd);
+        }
+    };
+
+    // hashers: hash windows and combine them per file (order independent, windows are seeded by position)
+    auto hash = [&]() {
+        while (std::optional<Window> w = windows.get()) {
+            auto [h1, h2] = hash_window(static_cast<const char *>(w->map), w->length, w->index);
+            sums[2*w->file] += h1;
+            sums[2*w->file + 1] += h2;
+            ::munmap(w->map, w->length);
+        }
+    };
+
+    std::vector<std::thread> readers, hashers;
+    for (unsigned int i=0; i<n_readers; i++)
+        readers.emplace_back(read);
+    for (unsigned int i=0; i<n_hashers; i++)
+        hashers.emplace_back(hash);
+    for (auto& r : readers)
+        r.join();
+    windows.close();
+    for (auto& h : hashers)
+        h.join();
+
+    std::vector<std::optional<Hash>> hashes(files.size());
+    for (std::size_t f=0; f<files.size(); f++)
+        if (!failed[f])
+            hashes[f] = Hash(fmix(sums[2*f]), fmix(sums[2*f + 1]));
+    return hashes;
+}
+
+std::vector<DuplicateSet> DuplicateFinder::refine(const std::vector<DuplicateSet>& groups, uintmax_t limit) const {
+    std::vector<std::shared_ptr<File>> files;
+    for (const auto& g : groups)
+        files.insert(files.end(), g.files.begin(), g.files.end());
+    std::vector<std::optional<Hash>> hashes = hash(files, limit);
+
+    std::vector<DuplicateSet> refined;
+    std::size_t f = 0;
+    for (const auto& g : groups) {
+        std::map<Hash, DuplicateSet> by_hash;
+        for (std::size_t i=0; i<g.files.size(); i++, f++) {
+            if (!hashes[f]) continue;
+            DuplicateSet& s = by_hash[*hashes[f]];
+            s.size = g.size;
+            s.files.push_back(g.files[i]);
+        }
+        for (auto& h : by_hash)
+            if (h.second.files.size() > 1)
+                refined.push_back(std::move(h.second));
+    }
+    return refined;
+}
+
+std::vector<DuplicateSet> DuplicateFinder::verify(const std::vector<DuplicateSet>& groups) const {
+    std::vector<std::vector<DuplicateSet>> verified(groups.size());
+    std::atomic<std::size_t> next_group{0};
+
+    auto compare = [&]() {
+        std::vector<char> buffer_a(compare_size), buffer_b(compare_size);
+        std::size_t g;
+        while ((g = next_group++) < groups.size()) {
+            std::vector<DuplicateSet>& contents = verified[g];
+            for (const auto& file : groups[g].files) {
+                auto same = std::find_if(contents.begin(), contents.end(), [&](const DuplicateSet& c) {
+                    return same_content(c.files.front()->getPath(), file->getPath(), groups[g].size,
+                                        buffer_a, buffer_b);
+                });
+                if (same == contents.end())
+                    contents.push_back(DuplicateSet{groups[g].size, {file}});
+                else
+                    same->files.push_back(file);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned int i=0; i<n_readers; i++)
+        threads.emplace_back(compare);
+    for (auto& t : threads)
+        t.join();
+
+    std::vector<DuplicateSet> result;
+    for (auto& contents : verified)
+        for (auto& c : contents)
+            if (c.files.size() > 1)
+                result.push_back(std::move(c));
+    return result;
+}
+
+std::vector<DuplicateSet> DuplicateFinder::find(const std::shared_ptr<Directory>& dir) const {
+    // collect files
+    std::vector<std::vector<std::shared_ptr<File>>> collected(n_hashers);
+    dir->parallelVisit([&collected](unsigned int thread_id, const Directory&, const std::shared_ptr<Base>& node) {
+        if (auto file = std::dynamic_pointer_cast<File>(node))
+            if (file->getSize() > 0)
+                collected[thread_id].push_back(std::move(file));
+    }, n_hashers);
+
+    // group by size
+    std::unordered_map<uintmax_t, DuplicateSet> by_size;
+    for (auto& files : collected) {
+        for (auto& file : files) {
+            DuplicateSet& s = by_size[file->getSize()];
+            s.size = file->getSize();
+            s.files.push_back(std::move(file));
+        }
+    }
+    std::vector<DuplicateSet> groups;
+    for (auto& s : by_size)
+        if (s.second.files.size() > 1)
+            groups.push_back(std::move(s.second));
+
+    // hash the head of the candidates, then the whole content of the big ones still matching
+    groups = refine(groups, head_size);
+    auto big = std::partition(groups.begin(), groups.end(), [](const DuplicateSet& g) { return g.size <= head_size; });
+    std::vector<DuplicateSet> big_groups(std::make_move_iterator(big), std::make_move_iterator(groups.end()));
+    groups.erase(big, groups.end());
+    for (auto& g : refine(big_groups, UINTMAX_MAX))
+        groups.push_back(std::move(g));
+    if (verify_content)
+        groups = verify(groups);
+
+    std::sort(groups.begin(), groups.end(), [](const DuplicateSet& a, const DuplicateSet& b) {
+        return a.reclaimable() > b.reclaimable();
+    });
+    return groups;
+}
@@ -0,0 +1,56 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include "Directory.h"
+#include "File.h"
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+// group of files with the same content
+struct DuplicateSet {
+    uintmax_t size;
+    std::vector<std::shared_ptr<File>> files;
+
+    uintmax_t reclaimable() const { return size * (files.size() - 1); }
+};
+
+// Finds duplicate files below a directory, assuming the tree mirrors the real file system (node path = real path).
+// Files are grouped by size, then candidates are hashed by a pipeline: reader threads map and populate windows of
+// the files, hasher threads hash them. At most max_windows windows of window_size bytes are in memory at a time.
+// Files in a set have the same 128-bit hash of the whole content, read once. The hash is not cryptographic: with
+// verify_content, the files left in a set are also compared byte by byte (n_readers threads, one more read of each
+// file), so that even a crafted collision cannot make different files reported as duplicates.
+class DuplicateFinder {
+    typedef std::pair<uint64_t, uint64_t> Hash;
+
+    unsigned int n_readers, n_hashers;
+    std::size_t window_size;
+    unsigned int max_windows;
+    bool verify_content;
+
+    static const std::size_t head_size = 64*1024;
+    static const std::size_t compare_size = 1024*1024;     // bytes read at a time from each file by verify()
+
+    // hash of the first limit bytes of each file, files that cannot be read get no hash
+    std::vector<std::optional<Hash>> hash(const std::vector<std::shared_ptr<File>>& files, uintmax_t limit) const;
+
+    // split each group by hash of the first limit bytes, dropping groups left with one file
+    std::vector<DuplicateSet> refine(const std::vector<DuplicateSet>& groups, uintmax_t limit) const;
+
+    // split each group into the files with identical content, dropping groups left with one file: each file is
+    // compared with the first file of each content found so far in the group (with equal hashes, almost always one)
+    std::vector<DuplicateSet> verify(const std::vector<DuplicateSet>& groups) const;
+
+public:
+    DuplicateFinder(unsigned int n_readers = 2, unsigned int n_hashers = 0,
+                    std::size_t window_size = 4*1024*1024, unsigned int max_windows = 16, bool verify_content = false);
+
+    // duplicate sets sorted by reclaimable bytes (descending)
+    std::vector<DuplicateSet> find(const std::shared_ptr<Directory>& dir) const;
+};
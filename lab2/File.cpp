@@ -3,20 +3,20 @@
 //
 
 #include "File.h"
+#include "TreeWriter.h"
 #include <iostream>
 
-File::File(const std::string &name, uintmax_t size): Base(name), size(size) {}
+File::File(const std::string &name, uintmax_t size, std::shared_ptr<Directory> parent): Base(name, parent), size(size) {}
 
-std::shared_ptr<File> File::makeFile(const std::string &name, uintmax_t size) {
-    return std::shared_ptr<File>{new File(name, size)};
+std::shared_ptr<File> File::makeFile(const std::string &name, uintmax_t size, std::shared_ptr<Directory> parent) {
+    return std::shared_ptr<File>{new File(name, size, parent)};
 }
 
 int File::mType() const { return File::TYPE; }
 
 void File::ls(int indent) const {
-    for (int i=0; i<indent; i++)
-        std::cout << " ";
-    std::cout << getName() << " " << size << std::endl;
+    TreeWriter writer(std::cout, TreeFormat::TEXT, indent);
+    writer.visitFile(*this, 0);
 }
 
 uintmax_t File::getSize() const { return size; }
@@ -11,10 +11,10 @@ class File: public Base {
     uintmax_t size;
     static const int TYPE = 1;
 
-    File(const std::string& name, uintmax_t size);
+    File(const std::string& name, uintmax_t size, std::shared_ptr<Directory> parent);
 
 public:
-    static std::shared_ptr<File> makeFile(const std::string& name, uintmax_t size);
+    static std::shared_ptr<File> makeFile(const std::string& name, uintmax_t size, std::shared_ptr<Directory> parent);
 
     int mType() const override;
     void ls(int indent) const override;
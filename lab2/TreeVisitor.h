@@ -0,0 +1,17 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+class Directory;
+class File;
+
+// callbacks of Directory::traverse, depth is relative to the traversed directory (0)
+class TreeVisitor {
+public:
+    virtual ~TreeVisitor() = default;
+    virtual void visitDirectory(const Directory& dir, int depth) = 0;
+    virtual void visitFile(const File& file, int depth) = 0;
+    virtual void leaveDirectory(const Directory& /*dir*/, int /*depth*/) {}
+};
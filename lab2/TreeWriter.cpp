@@ -0,0 +1,142 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#include "TreeWriter.h"
+#include "Directory.h"
+#include "File.h"
+#include <cstring>
+#include <charconv>
+
+BufferedWriter::BufferedWriter(std::ostream& out, std::size_t capacity): out(out), buffer(capacity), used(0) {}
+
+BufferedWriter::~BufferedWriter() {
+    flush();
+}
+
+void BufferedWriter::write(const char *data, std::size_t n) {
+    if (used + n > buffer.size()) {
+        flush();
+        if (n > buffer.size()) {    // too big, no copy
+            out.write(data, n);
+            return;
+        }
+    }
+    std::memcpy(buffer.data() + used, data, n);
+    used += n;
+}
+
+void BufferedWriter::fill(char c, std::size_t n) {
+    while (n > 0) {
+        if (used == buffer.size())
+            flush();
+        std::size_t k = std::min(n, buffer.size() - used);
+        std::memset(buffer.data() + used, c, k);
+        used += k;
+        n -= k;
+    }
+}
+
+void BufferedWriter::writeNumber(uintmax_t n) {
+    char digits[24];
+    char *end = std::to_chars(digits, digits + sizeof(digits), n).ptr;
+    write(digits, end - digits);
+}
+
+void BufferedWriter::flush() {
+    if (used > 0)
+        out.write(buffer.data(), used);
+    used = 0;
+}
+
+TreeWriter::TreeWriter(std::ostream& out, TreeFormat format, int indent): out(out), format(format), indent(indent) {}
+
+const std::string& TreeWriter::pathOf(const std::string& name, int depth) {
+    if (depth == 0)
+        return path = name;
+    path = paths[depth-1];
+    if (path.back() != '/')
+        path += '/';
+    return path += name;
+}
+
+void TreeWriter::writeJSONString(std::string_view s) {
+    out.put('"');
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out.put('\\');
+            out.put(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            const char *hex = "0123456789abcdef";
+            out.write("\\u00");
+            out.put(hex[c >> 4]);
+            out.put(hex[c & 0xf]);
+        } else {
+            out.put(c);
+        }
+    }
+    out.put('"');
+}
+
+void TreeWriter::writeBinary(uint8_t type, int depth, uint64_t size, const std::string& name) {
+    uint32_t d = depth, n = name.size();
+    out.write(reinterpret_cast<const char *>(&type), sizeof(type));
+    out.write(reinterpret_cast<const char *>(&d), sizeof(d));
+    out.write(reinterpret_cast<const char *>(&size), sizeof(size));
+    out.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    out.write(name);
+}
+
+void TreeWriter::visitDirectory(const Directory& dir, int depth) {
+    switch (format) {
+        case TreeFormat::TEXT:
+            out.fill(' ', indent + 4*depth);
+            out.write("[+] ");
+            out.write(dir.getName());
+            out.put('\n');
+            break;
+        case TreeFormat::JSON_LINES:
+            pathOf(depth == 0 ? dir.getPath() : dir.getName(), depth);
+            out.write("{\"path\":");
+            writeJSONString(path);
+            out.write(",\"type\":\"directory\",\"depth\":");
+            out.writeNumber(depth);
+            out.write("}\n");
+            if (paths.size() <= static_cast<std::size_t>(depth))
+                paths.resize(depth+1);
+            paths[depth] = path;
+            break;
+        case TreeFormat::BINARY:
+            writeBinary(0, depth, 0, dir.getName());
+            break;
+    }
+}
+
+void TreeWriter::visitFile(const File& file, int depth) {
+    switch (format) {
+        case TreeFormat::TEXT:
+            out.fill(' ', indent + 4*depth);
+            out.write(file.getName());
+            out.put(' ');
+            out.writeNumber(file.getSize());
+            out.put('\n');
+            break;
+        case TreeFormat::JSON_LINES:
+            pathOf(depth == 0 ? file.getPath() : file.getName(), depth);
+            out.write("{\"path\":");
+            writeJSONString(path);
+            out.write(",\"type\":\"file\",\"size\":");
+            out.writeNumber(file.getSize());
+            out.write(",\"depth\":");
+            out.writeNumber(depth);
+            out.write("}\n");
+            break;
+        case TreeFormat::BINARY:
+            writeBinary(1, depth, file.getSize(), file.getName());
+            break;
+    }
+}
+
+void TreeWriter::flush() {
+    out.flush();
+}
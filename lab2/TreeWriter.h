@@ -0,0 +1,58 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include "TreeVisitor.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// output stream sink writing large blocks instead of small pieces
+class BufferedWriter {
+    std::ostream& out;
+    std::vector<char> buffer;
+    std::size_t used;
+
+public:
+    BufferedWriter(std::ostream& out, std::size_t capacity = 1 << 16);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter& other) = delete;
+    BufferedWriter& operator=(const BufferedWriter& other) = delete;
+
+    void write(const char *data, std::size_t n);
+    void write(std::string_view s) { write(s.data(), s.size()); }
+    void put(char c) { if (used == buffer.size()) flush(); buffer[used++] = c; }
+    void fill(char c, std::size_t n);
+    void writeNumber(uintmax_t n);
+    void flush();
+};
+
+enum class TreeFormat {
+    TEXT,           // same as ls
+    JSON_LINES,     // one JSON object per entry: path, type, size (files), depth
+    BINARY          // per entry: type (uint8), depth (uint32), size (uint64), name length (uint32), name
+};
+
+// visitor dumping the entries in one of the formats
+class TreeWriter: public TreeVisitor {
+    BufferedWriter out;
+    TreeFormat format;
+    int indent;
+    std::vector<std::string> paths;     // JSON lines: path of the directories being visited, by depth
+    std::string path;
+
+    const std::string& pathOf(const std::string& name, int depth);
+    void writeJSONString(std::string_view s);
+    void writeBinary(uint8_t type, int depth, uint64_t size, const std::string& name);
+
+public:
+    TreeWriter(std::ostream& out, TreeFormat format = TreeFormat::TEXT, int indent = 0);
+
+    void visitDirectory(const Directory& dir, int depth) override;
+    void visitFile(const File& file, int depth) override;
+    void flush();
+};
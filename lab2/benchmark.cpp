@@ -0,0 +1,309 @@
+#include <iostream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <set>
+#include <fstream>
+#include <fnmatch.h>
+#include "Directory.h"
+#include "TreeWriter.h"
+
+// average time of fun() in nanoseconds
+template<typename F>
+double measure_ns(F fun, int repetitions) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i=0; i<repetitions; i++)
+        fun();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / repetitions;
+}
+
+/***************************
+ * Path lookup by depth    *
+ ***************************/
+void benchmark_lookup() {
+    const int max_depth = 64, repetitions = 100000;
+    auto root = Directory::getRoot();
+
+    // chain /d1/d2/.../d64, with some siblings at each level
+    std::vector<std::string> paths;
+    std::shared_ptr<Directory> dir = root->addDirectory("d1");
+    std::string path = "/d1";
+    paths.push_back(path);
+    for (int depth=2; depth<=max_depth; depth++) {
+        for (int i=0; i<16; i++)
+            dir->addFile("f" + std::to_string(i), i);
+        dir = dir->addDirectory("d" + std::to_string(depth));
+        path += "/d" + std::to_string(depth);
+        paths.push_back(path);
+    }
+
+    std::cout << "Path lookup latency (ns):\n";
+    std::cout << "depth\twalk\tindex\n";
+    for (int depth : {1, 2, 4, 8, 16, 32, 64}) {
+        const std::string& p = paths[depth-1];
+        Directory::setPathIndex(false);
+        double walk = measure_ns([&p]() { Directory::lookup(p); }, repetitions);
+        Directory::setPathIndex(true);
+        double index = measure_ns([&p]() { Directory::lookup(p); }, repetitions);
+        std::cout << depth << "\t" << walk << "\t" << index << "\n";
+    }
+    Directory::setPathIndex(false);
+
+    root->remove("d1");
+}
+
+/************************************
+ * Diff of mostly unchanged trees   *
+ ************************************/
+void build_tree(const std::shared_ptr<Directory>& dir, int depth, int fanout, int files) {
+    for (int i=0; i<files; i++)
+        dir->addFile("f" + std::to_string(i), i);
+    if (depth > 0)
+        for (int i=0; i<fanout; i++)
+            build_tree(dir->addDirectory("d" + std::to_string(i)), depth-1, fanout, files);
+}
+
+void benchmark_diff() {
+    auto root = Directory::getRoot();
+    auto before = root->addDirectory("before"), after = root->addDirectory("after");
+    build_tree(before, 4, 10, 10);     // ~120k entries each
+    build_tree(after, 4, 10, 10);
+
+    std::cout << "Diff (us):\n";
+    double identical = measure_ns([&]() { before->diff(after); }, 100) / 1000;
+    after->getDir("d3")->getDir("d1")->getDir("d4")->remove("f2");
+    after->getDir("d3")->getDir("d1")->getDir("d4")->addFile("f2", 1000);
+    after->getDir("d7")->addFile("new", 1);
+    double changed = measure_ns([&]() { before->diff(after); }, 100) / 1000;
+    std::cout << "identical\t" << identical << "\n" << "2 changes\t" << changed
+              << " (" << before->diff(after).size() << " entries)\n";
+
+    root->remove("before");
+    root->remove("after");
+}
+
+/************************************
+ * Name index after removals        *
+ ************************************/
+// find() against a search of the whole tree, on a large tree (parallel glob), after removing files and most
+// of the subtrees (sequential glob) and after changing a removed subtree still held, which must not show up in the
+// index nor in the digest of the tree; returns false if they differ
+bool check_find() {
+    auto root = Directory::getRoot();
+    auto tree = root->addDirectory("tree");
+    build_tree(tree, 4, 10, 10);       // ~120k entries
+
+    auto check = []() {
+        for (const std::string pattern : {"f1", "d3", "f1*", "*9", "d[0-3]", "f?", "missing*"}) {
+            std::multiset<std::string> found, expected;
+            for (const auto& node : Directory::find(pattern))
+                found.insert(node->getPath());
+            Directory::getRoot()->parallelVisit([&](unsigned int, const Directory&, const std::shared_ptr<Base>& node) {
+                if (fnmatch(pattern.c_str(), node->getName().c_str(), 0) == 0)
+                    expected.insert(node->getPath());
+            }, 1);
+            if (found != expected)
+                return false;
+        }
+        return true;
+    };
+
+    bool ok = check();
+    std::shared_ptr<Directory> removed = tree->getDir("d0");
+    for (int i=0; i<9; i++)
+        tree->remove("d" + std::to_string(i));
+    for (int i=0; i<10; i+=2)
+        tree->getDir("d9")->remove("f" + std::to_string(i));
+    ok = check() && ok;
+
+    uint64_t digest = root->getDigest();
+    removed->remove("f1");
+    removed->addFile("f1", 1000);
+    removed->getDir("d1")->addDirectory("new")->addFile("f1", 1);
+    ok = check() && Directory::find("new").empty() && root->getDigest() == digest && ok;
+
+    root->remove("tree");
+    return ok;
+}
+
+/****************************************
+ * Concurrent readers and writers       *
+ ****************************************/
+// writers add and remove their own files in random directories, readers look up paths, visit and search the tree;
+// returns false if the tree is inconsistent at the end
+bool stress_concurrency(int n_writers, int n_readers, int n_operations) {
+    auto root = Directory::getRoot();
+    auto shared = root->addDirectory("shared");
+    build_tree(shared, 2, 10, 10);
+    std::vector<std::string> dirs{"/shared"};
+    for (int i=0; i<10; i++) {
+        dirs.push_back("/shared/d" + std::to_string(i));
+        for (int j=0; j<10; j++)
+            dirs.push_back("/shared/d" + std::to_string(i) + "/d" + std::to_string(j));
+    }
+
+    Directory::setConcurrent(true);
+    std::atomic<bool> done{false};
+    std::vector<std::set<std::pair<std::string,std::string>>> written(n_writers);    // final (dir, name) of each writer
+    std::vector<std::thread> writers, readers;
+    for (int w=0; w<n_writers; w++) {
+        writers.emplace_back([&, w]() {
+            std::mt19937 gen(w);
+            for (int i=0; i<n_operations; i++) {
+                const std::string& dir = dirs[gen() % dirs.size()];
+                std::string name = "w" + std::to_string(w) + "_" + std::to_string(gen() % 50);
+                auto d = std::static_pointer_cast<Directory>(Directory::lookup(dir));
+                if (d->remove(name))
+                    written[w].erase({dir, name});
+                else if (d->addFile(name, w))
+                    written[w].insert({dir, name});
+            }
+        });
+    }
+    for (int r=0; r<n_readers; r++) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 gen(1000 + r);
+            while (!done) {
+                Directory::lookup(dirs[gen() % dirs.size()] + "/f" + std::to_string(gen() % 10));
+                Directory::find("w" + std::to_string(gen() % n_writers) + "_1*");
+                std::size_t n = 0;
+                shared->parallelVisit([&n](unsigned int, const Directory&, const std::shared_ptr<Base>&) { n++; }, 1);
+            }
+        });
+    }
+    for (auto& w : writers)
+        w.join();
+    done = true;
+    for (auto& r : readers)
+        r.join();
+    Directory::setConcurrent(false);
+
+    // check: same tree rebuilt sequentially, index and digests must match
+    auto expected = root->addDirectory("expected");
+    build_tree(expected, 2, 10, 10);
+    std::size_t n_written = 0;
+    for (int w=0; w<n_writers; w++) {
+        for (const auto& entry : written[w]) {
+            auto d = std::static_pointer_cast<Directory>(Directory::lookup("/expected" + entry.first.substr(7)));
+            d->addFile(entry.second, w);
+        }
+        n_written += written[w].size();
+    }
+    bool ok = shared->getDigest() == expected->getDigest() && shared->diff(expected).empty() &&
+            Directory::find("w*").size() == 2*n_written;
+
+    root->remove("shared");
+    root->remove("expected");
+    return ok;
+}
+
+void benchmark_concurrency() {
+    const int n_lookups = 200000;
+    auto root = Directory::getRoot();
+    auto shared = root->addDirectory("shared");
+    build_tree(shared, 3, 10, 10);
+    Directory::setConcurrent(true);
+
+    std::cout << "Concurrent lookups with one writer (lookups/s):\n";
+    std::cout << "readers\tlookups/s\n";
+    for (int n_readers : {1, 2, 4, 8}) {
+        std::atomic<bool> done{false};
+        std::thread writer([&]() {
+            auto dir = shared->getDir("d5")->getDir("d5");
+            for (int i=0; !done; i++) {
+                std::string name = "w" + std::to_string(i % 100);
+                if (!dir->remove(name))
+                    dir->addFile(name, i);
+            }
+        });
+        std::vector<std::thread> readers;
+        auto start = std::chrono::steady_clock::now();
+        for (int r=0; r<n_readers; r++) {
+            readers.emplace_back([&, r]() {
+                std::mt19937 gen(r);
+                for (int i=0; i<n_lookups; i++)
+                    Directory::lookup("/shared/d" + std::to_string(gen() % 10) + "/d" + std::to_string(gen() % 10) +
+                                      "/d" + std::to_string(gen() % 10) + "/f" + std::to_string(gen() % 10));
+            });
+        }
+        for (auto& r : readers)
+            r.join();
+        auto end = std::chrono::steady_clock::now();
+        done = true;
+        writer.join();
+        std::cout << n_readers << "\t" << n_readers * n_lookups / std::chrono::duration<double>(end - start).count()
+                  << "\n";
+    }
+
+    Directory::setConcurrent(false);
+    root->remove("shared");
+}
+
+/************************
+ * Tree dump            *
+ ************************/
+void benchmark_dump() {
+    auto root = Directory::getRoot();
+    auto tree = root->addDirectory("tree");
+    build_tree(tree, 4, 10, 80);   // ~900k entries
+    std::ofstream null("/dev/null", std::ios::binary);
+
+    std::cout << "Dump of ~900k entries to /dev/null (ms):\n";
+    std::streambuf *cout_buf = std::cout.rdbuf(null.rdbuf());
+    double ls = measure_ns([&]() { tree->ls(0); }, 3) / 1e6;
+    std::cout.rdbuf(cout_buf);
+    std::cout << "ls\t\t" << ls << "\n";
+    for (auto format : {TreeFormat::TEXT, TreeFormat::JSON_LINES, TreeFormat::BINARY}) {
+        const char *name = format == TreeFormat::TEXT ? "text" : format == TreeFormat::JSON_LINES ? "json" : "binary";
+        for (bool sorted : {false, true}) {
+            double ms = measure_ns([&]() {
+                TreeWriter writer(null, format);
+                tree->traverse(writer, sorted);
+            }, 3) / 1e6;
+            std::cout << name << (sorted ? " sorted" : "") << "\t" << (sorted ? "" : "\t") << ms << "\n";
+        }
+    }
+
+    root->remove("tree");
+}
+
+/************************************
+ * Top-N and size histogram         *
+ ************************************/
+void benchmark_size_stats() {
+    auto root = Directory::getRoot();
+    auto tree = root->addDirectory("tree");
+    build_tree(tree, 4, 10, 80);   // ~900k files
+
+    std::cout << "Top-100 and histogram of ~900k files (ms):\n";
+    std::cout << "threads\tms\n";
+    for (unsigned int n_threads : {1, 2, 4, 8}) {
+        double ms = measure_ns([&]() { tree->sizeStats(100, n_threads); }, 5) / 1e6;
+        std::cout << n_threads << "\t" << ms << "\n";
+    }
+
+    root->remove("tree");
+}
+
+int main() {
+    benchmark_lookup();
+    benchmark_diff();
+    benchmark_concurrency();
+    benchmark_dump();
+    benchmark_size_stats();
+
+    bool ok = check_find();
+    std::cout << "Find after removals: " << (ok ? "ok" : "FAILED") << std::endl;
+    if (!ok)
+        return 1;
+
+    ok = stress_concurrency(4, 4, 10000);
+    std::cout << "Concurrency stress test: " << (ok ? "ok" : "FAILED") << std::endl;
+    if (!ok)
+        return 1;
+    return 0;
+}
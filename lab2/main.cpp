@@ -1,5 +1,7 @@
 #include <iostream>
 #include "Directory.h"
+#include "DuplicateFinder.h"
+#include "TreeWriter.h"
 #include <filesystem>
 
 namespace fs = std::filesystem;
@@ -43,6 +45,48 @@ int main() {
             cur_dir->addDirectory(name);
     }
     root->ls(0);
+    std::cout << "\n\n";
+
+    // first two levels of the current directory, sorted, as JSON lines
+    {
+        TreeWriter writer(std::cout, TreeFormat::JSON_LINES);
+        std::static_pointer_cast<Directory>(Directory::lookup(fs::current_path()))->traverse(writer, true, 2);
+    }
+    std::cout << "\n\n";
+
+    // size report of the current directory
+    SizeStats stats = std::static_pointer_cast<Directory>(Directory::lookup(fs::current_path()))->sizeStats(5);
+    std::cout << stats.files << " files, " << stats.bytes << " bytes, largest:" << std::endl;
+    for (const auto& file : stats.largest)
+        std::cout << "    " << file->getPath() << " " << file->getSize() << std::endl;
+    std::cout << "size histogram:" << std::endl;
+    for (std::size_t i=0; i<stats.histogram.size(); i++)
+        if (stats.histogram[i] > 0)
+            std::cout << "    < 2^" << i << " bytes: " << stats.histogram[i] << std::endl;
+    std::cout << "\n\n";
+
+    // search by name
+    for (const std::string pattern : {"main.cpp", "CMake*", "*.h", "[A-Z]*.cpp"}) {
+        std::cout << "find " << pattern << ":" << std::endl;
+        for (const auto& node : Directory::find(pattern))
+            std::cout << node->getPath() << std::endl;
+    }
+
+    // resolve paths with the path index
+    Directory::setPathIndex(true);
+    std::string cwd{fs::current_path()};
+    for (const std::string& path : {cwd + "/main.cpp", cwd + "/../lab2/./CMakeLists.txt", cwd + "/missing"}) {
+        auto node = Directory::lookup(path);
+        std::cout << path << " => " << (node ? node->getPath() : "not found") << std::endl;
+    }
+
+    // duplicate files
+    std::cout << "\nDuplicates:" << std::endl;
+    for (const auto& duplicates : DuplicateFinder().find(root)) {
+        std::cout << duplicates.reclaimable() << " bytes reclaimable:" << std::endl;
+        for (const auto& file : duplicates.files)
+            std::cout << "    " << file->getPath() << std::endl;
+    }
 
     return 0;
 }
@@ -0,0 +1,70 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Encoding of lengths and trivially copyable attributes in the binary format
+enum class BinaryFormat {
+    SIZE_T,         // std::size_t lengths for objects, strings and attributes (original format)
+    VARINT,         // LEB128 lengths, integral attributes as (zigzag) LEB128 without length
+    VARINT_FIXED    // LEB128 lengths, trivially copyable attributes as raw bytes without length, vectors of packed
+                    // objects as one raw array (see serialize_binary())
+};
+
+/*********************
+ * LEB128 primitives *
+ *********************/
+
+constexpr std::size_t max_varint_size = 10;     // 64 bits, 7 per byte
+
+constexpr std::size_t varint_size(uint64_t value) {
+    std::size_t n = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        n++;
+    }
+    return n;
+}
+
+// writes value at ptr (max_varint_size bytes available), returns the number of bytes written
+inline std::size_t varint_encode(uint64_t value, char *ptr) {
+    std::size_t n = 0;
+    while (value >= 0x80) {
+        ptr[n++] = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    ptr[n++] = static_cast<char>(value);
+    return n;
+}
+
+// writes the size header of a message (or object) in format at ptr (max_varint_size bytes available), returns its size
+inline std::size_t size_encode(std::size_t size, BinaryFormat format, char *ptr) {
+    if (format != BinaryFormat::SIZE_T)
+        return varint_encode(size, ptr);
+    std::memcpy(ptr, &size, sizeof(size));
+    return sizeof(size);
+}
+
+template<typename I>
+constexpr uint64_t zigzag_encode(I value) {
+    if constexpr (std::is_signed_v<I>) {
+        auto v = static_cast<int64_t>(value);
+        return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+template<typename I>
+constexpr I zigzag_decode(uint64_t value) {
+    if constexpr (std::is_signed_v<I>)
+        return static_cast<I>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+    else
+        return static_cast<I>(value);
+}
@@ -0,0 +1,98 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <span>
+#include <string>
+#include <cstring>
+#include <type_traits>
+#include <stdexcept>
+#include "BinaryFormat.h"
+
+// Binary deserialization from a span, counterpart of BinaryWriter
+class BinaryReader {
+    std::span<const char> buffer;
+    std::size_t position;
+    BinaryFormat format;
+
+    const char *take(std::size_t n) {
+        if (n > buffer.size() - position)
+            throw std::out_of_range("BinaryReader: read past the end of the buffer");
+        const char *p = buffer.data() + position;
+        position += n;
+        return p;
+    }
+
+    uint64_t readVarint() {
+        uint64_t value = 0;
+        for (unsigned int shift = 0; shift < 64; shift += 7) {
+            auto byte = static_cast<unsigned char>(*take(1));
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return value;
+        }
+        throw std::out_of_range("BinaryReader: varint too long");
+    }
+
+public:
+    BinaryReader(std::span<const char> buffer, BinaryFormat format = BinaryFormat::SIZE_T) :
+            buffer(buffer), position(0), format(format) {}
+    BinaryReader(const char *data, std::size_t size, BinaryFormat format = BinaryFormat::SIZE_T) :
+            buffer(data, size), position(0), format(format) {}
+
+    // size of the serialized object starting at data, total size included
+    static std::size_t objectSize(const char *data, BinaryFormat format = BinaryFormat::SIZE_T) {
+        if (format == BinaryFormat::SIZE_T) {
+            std::size_t total_size;
+            std::memcpy(&total_size, data, sizeof(total_size));
+            return sizeof(total_size) + total_size;
+        }
+        BinaryReader reader(data, max_varint_size, format);     // the header is complete, the bound is not reached
+        std::size_t total_size = reader.readSize();
+        return reader.getPosition() + total_size;
+    }
+
+    BinaryFormat getFormat() const { return format; }
+    bool atEnd() const { return position == buffer.size(); }
+    std::size_t getPosition() const { return position; }
+    void skip(std::size_t n) { take(n); }
+
+    // raw bytes, without size: the returned pointer is into the buffer
+    const char *readBytes(std::size_t n) { return take(n); }
+
+    std::size_t readSize() {
+        if (format != BinaryFormat::SIZE_T)
+            return readVarint();
+        std::size_t size;
+        std::memcpy(&size, take(sizeof(size)), sizeof(size));
+        return size;
+    }
+
+    template<typename A>
+    void read(A& a) {
+        static_assert(std::is_trivially_copyable_v<A>, "attribute must be trivially copyable");
+        if (format == BinaryFormat::SIZE_T) {
+            skip(sizeof(std::size_t));      // size (same as sizeof(A))
+            std::memcpy(&a, take(sizeof(a)), sizeof(a));
+        } else if (std::is_integral_v<A> && format == BinaryFormat::VARINT) {
+            if constexpr (std::is_integral_v<A>)
+                a = zigzag_decode<A>(readVarint());
+        } else {
+            std::memcpy(&a, take(sizeof(a)), sizeof(a));
+        }
+    }
+
+    void read(std::string& a) {
+        std::size_t size = readSize();
+        a.assign(take(size), size);
+    }
+
+    template<typename A>
+    A read() {
+        A a;
+        read(a);
+        return a;
+    }
+};
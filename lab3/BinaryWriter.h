@@ -0,0 +1,99 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <type_traits>
+#include "BinaryFormat.h"
+
+// Binary serialization into one growable buffer (SIZE_T is the format of serialize_binary_attribute/serialize_binary_size):
+// attribute = size + bytes, object = total size + attributes (the total size is patched when the object ends).
+class BinaryWriter {
+    std::vector<char> buffer;
+    BinaryFormat format;
+
+    void append(const void *data, std::size_t n) {
+        const char *p = static_cast<const char *>(data);
+        buffer.insert(buffer.end(), p, p + n);
+    }
+
+    void appendVarint(uint64_t value) {
+        char tmp[max_varint_size];
+        append(tmp, varint_encode(value, tmp));
+    }
+
+public:
+    BinaryWriter(BinaryFormat format = BinaryFormat::SIZE_T, std::size_t capacity = 256) : format(format) {
+        buffer.reserve(capacity);
+    }
+
+    BinaryFormat getFormat() const { return format; }
+    std::size_t size() const { return buffer.size(); }
+    const char *data() const { return buffer.data(); }
+    void clear() { buffer.clear(); }
+    void reserve(std::size_t capacity) { buffer.reserve(capacity); }
+
+    // moves the buffer out, the writer is left empty
+    std::vector<char> release() { return std::move(buffer); }
+
+    // exchanges the buffer with other, e.g. to hand it over and get back a used one
+    void swapBuffer(std::vector<char>& other) { buffer.swap(other); }
+
+    // raw bytes, without size
+    void writeBytes(const void *data, std::size_t n) {
+        append(data, n);
+    }
+
+    void writeSize(std::size_t size) {
+        if (format == BinaryFormat::SIZE_T)
+            append(&size, sizeof(size));
+        else
+            appendVarint(size);
+    }
+
+    template<typename A>
+    void write(const A& a) {
+        static_assert(std::is_trivially_copyable_v<A>, "attribute must be trivially copyable");
+        if (format == BinaryFormat::SIZE_T) {
+            writeSize(sizeof(a));
+            append(&a, sizeof(a));
+        } else if (std::is_integral_v<A> && format == BinaryFormat::VARINT) {
+            if constexpr (std::is_integral_v<A>)
+                appendVarint(zigzag_encode(a));
+        } else {
+            append(&a, sizeof(a));
+        }
+    }
+
+    void write(const std::string& a) {
+        writeSize(a.size());
+        append(a.data(), a.size());
+    }
+
+    // reserve the total size of an object, returns its position for endObject()
+    std::size_t beginObject() {
+        std::size_t position = buffer.size();
+        if (format == BinaryFormat::SIZE_T)
+            writeSize(0);
+        else
+            buffer.push_back(0);    // one byte, enough for objects smaller than 128 bytes
+        return position;
+    }
+
+    void endObject(std::size_t position) {
+        if (format == BinaryFormat::SIZE_T) {
+            std::size_t total_size = buffer.size() - position - sizeof(total_size);
+            std::memcpy(buffer.data() + position, &total_size, sizeof(total_size));
+        } else {
+            std::size_t total_size = buffer.size() - position - 1;
+            std::size_t n = varint_size(total_size);
+            if (n > 1)      // make room for the longer size
+                buffer.insert(buffer.begin() + position + 1, n - 1, 0);
+            varint_encode(total_size, buffer.data() + position);
+        }
+    }
+};
@@ -0,0 +1,26 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <cstddef>
+#include "Serializable.h"
+
+// Line-aligned byte range of a MappedFile, sent to a mapper instead of the lines
+class InputSplit: public Serializable<InputSplit> {
+    std::size_t offset;
+    std::size_t length;
+
+    static constexpr auto fields() {
+        return std::make_tuple(field("offset", &InputSplit::offset),
+                               field("length", &InputSplit::length));
+    }
+    friend class Serializable<InputSplit>;
+
+public:
+    InputSplit(): offset(0), length(0) {}
+    InputSplit(std::size_t offset, std::size_t length): offset(offset), length(length) {}
+    std::size_t getOffset() const { return offset; }
+    std::size_t getLength() const { return length; }
+};
@@ -0,0 +1,226 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+// Pull JSON parser over a buffer, counterpart of JsonWriter. Values may be strings (as written by ptree) or
+// bare literals; string values without escapes are returned as views into the buffer.
+class JsonReader {
+    std::span<const char> buffer;
+    std::size_t position;
+    std::string scratch_key, scratch_value;     // unescaped strings, valid until the next read
+
+    [[noreturn]] void error(const std::string& what) const {
+        throw std::runtime_error("JsonReader: " + what + " at offset " + std::to_string(position));
+    }
+
+    void skipWhitespace() {
+        while (position < buffer.size() &&
+               (buffer[position] == ' ' || buffer[position] == '\n' || buffer[position] == '\r' ||
+                buffer[position] == '\t'))
+            position++;
+    }
+
+    char peek() {
+        skipWhitespace();
+        if (position == buffer.size())
+            error("unexpected end of input");
+        return buffer[position];
+    }
+
+    void expect(char c) {
+        if (peek() != c)
+            error(std::string("expected '") + c + "'");
+        position++;
+    }
+
+    static void appendUtf8(std::string& s, unsigned long cp) {
+        if (cp < 0x80) {
+            s.push_back(static_cast<char>(cp));
+        } else if (cp < 0x800) {
+            s.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else if (cp < 0x10000) {
+            s.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        } else {
+            s.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            s.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    unsigned long readHex4() {
+        if (buffer.size() - position < 4)
+            error("truncated \\u escape");
+        unsigned long cp = 0;
+        auto result = std::from_chars(buffer.data() + position, buffer.data() + position + 4, cp, 16);
+        if (result.ptr != buffer.data() + position + 4)
+            error("invalid \\u escape");
+        position += 4;
+        return cp;
+    }
+
+    // string starting at the current '"', as a view into the buffer or, with escapes, into scratch
+    std::string_view readString(std::string& scratch) {
+        expect('"');
+        std::size_t start = position;
+        while (position < buffer.size() && buffer[position] != '"' && buffer[position] != '\\')
+            position++;
+        if (position == buffer.size())
+            error("unterminated string");
+        if (buffer[position] == '"')
+            return std::string_view(buffer.data() + start, position++ - start);
+
+        // slow path: unescape
+        scratch.assign(buffer.data() + start, position - start);
+        while (true) {
+            if (position == buffer.size())
+                error("unterminated string");
+            char c = buffer[position++];
+            if (c == '"')
+                return scratch;
+            if (c != '\\') {
+                scratch.push_back(c);
+                continue;
+            }
+            if (position == buffer.size())
+                error("unterminated string");
+            switch (c = buffer[position++]) {
+                case 'b': scratch.push_back('\b'); break;
+                case 'f': scratch.push_back('\f'); break;
+                case 'n': scratch.push_back('\n'); break;
+                case 'r': scratch.push_back('\r'); break;
+                case 't': scratch.push_back('\t'); break;
+                case '"': case '\\': case '/': scratch.push_back(c); break;
+                case 'u': {
+                    unsigned long cp = readHex4();
+                    if (cp >= 0xDC00 && cp < 0xE000)
+                        error("unpaired low surrogate");
+                    if (cp >= 0xD800 && cp < 0xDC00) {      // surrogate pair: a low surrogate must follow
+                        if (buffer.size() - position < 2 || buffer[position] != '\\' || buffer[position+1] != 'u')
+                            error("unpaired high surrogate");
+                        position += 2;
+                        unsigned long low = readHex4();
+                        if (low < 0xDC00 || low >= 0xE000)
+                            error("unpaired high surrogate");
+                        cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(scratch, cp);
+                    break;
+                }
+                default:
+                    error("invalid escape");
+            }
+        }
+    }
+
+    // bare literal (number, true, false, null)
+    std::string_view readLiteral() {
+        skipWhitespace();
+        std::size_t start = position;
+        while (position < buffer.size() && std::strchr(",}] \n\r\t", buffer[position]) == nullptr)
+            position++;
+        if (position == start)
+            error("expected a value");
+        return std::string_view(buffer.data() + start, position - start);
+    }
+
+public:
+    JsonReader(std::span<const char> buffer) : buffer(buffer), position(0) {}
+    JsonReader(const char *data, std::size_t size) : buffer(data, size), position(0) {}
+
+    std::size_t getPosition() const { return position; }
+    bool atEnd() { skipWhitespace(); return position == buffer.size(); }
+    bool isString() { return peek() == '"'; }
+
+    void beginObject() { expect('{'); }
+    void beginArray() { expect('['); }
+
+    // next member of the current object, false (and the object is consumed) at its end
+    bool nextMember(std::string_view& key) {
+        char c = peek();
+        if (c == '}') {
+            position++;
+            return false;
+        }
+        if (c == ',')
+            position++;
+        key = readString(scratch_key);
+        expect(':');
+        return true;
+    }
+
+    // next element of the current array, false (and the array is consumed) at its end
+    bool nextElement() {
+        char c = peek();
+        if (c == ']') {
+            position++;
+            return false;
+        }
+        if (c == ',')
+            position++;
+        return true;
+    }
+
+    // scalar value as text
+    std::string_view readValue() {
+        if (isString())
+            return readString(scratch_value);
+        return readLiteral();
+    }
+
+    void skipValue() {
+        std::string_view key;
+        switch (peek()) {
+            case '{':
+                beginObject();
+                while (nextMember(key))
+                    skipValue();
+                break;
+            case '[':
+                beginArray();
+                while (nextElement())
+                    skipValue();
+                break;
+            default:
+                readValue();
+        }
+    }
+
+    template<typename A>
+    void read(A& a) {
+        std::string_view v = readValue();
+        if constexpr (std::is_same_v<A, std::string>) {
+            a.assign(v);
+        } else if constexpr (std::is_same_v<A, bool>) {
+            if (v == "true" || v == "1") a = true;
+            else if (v == "false" || v == "0") a = false;
+            else error("invalid bool");
+        } else if constexpr (std::is_same_v<A, char>) {
+            if (v.size() != 1)
+                error("invalid char");
+            a = v[0];
+        } else if constexpr (std::is_arithmetic_v<A>) {
+            auto result = std::from_chars(v.data(), v.data() + v.size(), a);
+            if (result.ec != std::errc() || result.ptr != v.data() + v.size())
+                error("invalid number");
+        } else {
+            std::istringstream iss{std::string(v)};
+            if (!(iss >> a))
+                error("invalid value");
+        }
+    }
+};
@@ -0,0 +1,146 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <charconv>
+#include <limits>
+#include <type_traits>
+
+// Streaming JSON serialization into one growable buffer, same output as pt::write_json (pretty, 4 spaces,
+// every value written as a string), without building a ptree
+class JsonWriter {
+    std::vector<char> buffer;
+    std::vector<bool> first;        // per open object/array: no member written yet
+
+    void append(std::string_view s) {
+        buffer.insert(buffer.end(), s.begin(), s.end());
+    }
+
+    void indent() {
+        buffer.insert(buffer.end(), 4 * first.size(), ' ');
+    }
+
+    // characters escaped by pt::json_parser::create_escapes
+    static constexpr std::array<bool,256> escaped = []() {
+        std::array<bool,256> table{};
+        for (int c = 0; c < 0x20; c++)
+            table[c] = true;
+        table['"'] = table['/'] = table['\\'] = true;
+        return table;
+    }();
+
+    void appendEscaped(std::string_view s) {
+        std::size_t run = 0;    // start of the characters not yet appended
+        for (std::size_t i = 0; i < s.size(); i++) {
+            auto c = static_cast<unsigned char>(s[i]);
+            if (!escaped[c])
+                continue;
+            append(s.substr(run, i - run));
+            run = i + 1;
+            switch (c) {
+                case '\b': append("\\b"); break;
+                case '\f': append("\\f"); break;
+                case '\n': append("\\n"); break;
+                case '\r': append("\\r"); break;
+                case '\t': append("\\t"); break;
+                case '/':  append("\\/"); break;
+                case '"':  append("\\\""); break;
+                case '\\': append("\\\\"); break;
+                default: {
+                    const char *hexdigits = "0123456789ABCDEF";
+                    char u[] = {'\\', 'u', '0', '0', hexdigits[c / 16], hexdigits[c % 16]};
+                    append(std::string_view(u, sizeof(u)));
+                }
+            }
+        }
+        append(s.substr(run));
+    }
+
+    // starts a member of an object or an element of an array
+    void next() {
+        if (!first.back())
+            buffer.push_back(',');
+        buffer.push_back('\n');
+        first.back() = false;
+        indent();
+    }
+
+    void open(char c) {
+        buffer.push_back(c);
+        first.push_back(true);
+    }
+
+    void close(char c) {
+        first.pop_back();
+        buffer.push_back('\n');
+        indent();
+        buffer.push_back(c);
+    }
+
+public:
+    JsonWriter(std::size_t capacity = 256) { buffer.reserve(capacity); }
+
+    std::size_t size() const { return buffer.size(); }
+    const char *data() const { return buffer.data(); }
+    void clear() { buffer.clear(); first.clear(); }
+    void reserve(std::size_t capacity) { buffer.reserve(capacity); }
+
+    // moves the buffer out, the writer is left empty
+    std::vector<char> release() { first.clear(); return std::move(buffer); }
+
+    void beginObject() { open('{'); }
+    void endObject() { close('}'); }
+    void beginArray() { open('['); }
+    void endArray() { close(']'); }
+
+    // element of the enclosing array, followed by its value
+    void element() { next(); }
+
+    // member of the enclosing object, followed by its value
+    void key(std::string_view name) {
+        next();
+        buffer.push_back('"');
+        appendEscaped(name);
+        append("\": ");
+    }
+
+    void value(std::string_view v) {
+        buffer.push_back('"');
+        appendEscaped(v);
+        buffer.push_back('"');
+    }
+
+    template<typename A>
+    void value(const A& a) {
+        if constexpr (std::is_convertible_v<const A&, std::string_view>) {
+            value(std::string_view(a));
+        } else if constexpr (std::is_same_v<A, bool>) {
+            value(std::string_view(a ? "true" : "false"));
+        } else if constexpr (std::is_same_v<A, char>) {
+            value(std::string_view(&a, 1));
+        } else if constexpr (std::is_arithmetic_v<A>) {
+            char tmp[64];
+            std::to_chars_result result;
+            if constexpr (std::is_floating_point_v<A>)      // same precision as ptree
+                result = std::to_chars(tmp, tmp + sizeof(tmp), a, std::chars_format::general,
+                                       std::numeric_limits<A>::max_digits10);
+            else
+                result = std::to_chars(tmp, tmp + sizeof(tmp), a);
+            value(std::string_view(tmp, result.ptr - tmp));
+        } else {
+            std::ostringstream oss;
+            oss << a;
+            value(std::string_view(oss.str()));
+        }
+    }
+
+    // end of the document, as the std::endl of pt::write_json
+    void finish() { buffer.push_back('\n'); }
+};
@@ -0,0 +1,108 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <iterator>
+#include "Serializable.h"
+#include "MapperInput.h"
+#include "Result.h"
+#include "ReducerInput.h"
+
+/*****************************************************************
+ * Previous binary path: one temporary vector per attribute/object *
+ *****************************************************************/
+// The binary codecs before BinaryWriter/BinaryReader, kept as the baseline of the benchmarks: the same bytes as
+// serialize_binary(objs) (SIZE_T), built through one temporary vector per attribute and per object.
+inline std::vector<char> legacy_serialize(const MapperInput& obj) {
+    std::string input = obj.getInput();
+    std::size_t total_size = sizeof(std::size_t) + input.size();
+    std::vector<char> serialized_obj = serialize_binary_size(total_size);
+    std::vector<char> tmp = serialize_binary_attribute(input);
+    std::copy(tmp.begin(), tmp.end(), std::back_inserter(serialized_obj));
+    return serialized_obj;
+}
+
+inline std::vector<char> legacy_serialize(const Result<std::string,int>& obj) {
+    std::vector<char> tmp, serialized_obj;
+    std::string key = obj.getKey();
+    int value = obj.getValue();
+    std::size_t total_size = 2*sizeof(std::size_t) + key.size() + sizeof(value);
+    serialized_obj = serialize_binary_size(total_size);
+    tmp = serialize_binary_attribute(key);
+    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
+    tmp = serialize_binary_attribute(value);
+    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
+    return serialized_obj;
+}
+
+inline std::vector<char> legacy_serialize(const ReducerInput<std::string,std::string,std::string>& obj) {
+    std::vector<char> tmp, serialized_obj;
+    std::string key = obj.getKey(), value = obj.getValue(), acc = obj.getAcc();
+    std::size_t total_size = 3*sizeof(std::size_t) + key.size() + value.size() + acc.size();
+    serialized_obj = serialize_binary_size(total_size);
+    tmp = serialize_binary_attribute(key);
+    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
+    tmp = serialize_binary_attribute(value);
+    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
+    tmp = serialize_binary_attribute(acc);
+    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
+    return serialized_obj;
+}
+
+template<typename T>
+std::vector<char> legacy_serialize(const std::vector<T>& objs) {
+    std::vector<char> serialized_objs;
+    std::size_t total_size = 0;
+    for (const auto& obj : objs) {
+        std::vector<char> serialized_obj = legacy_serialize(obj);
+        std::copy(std::move_iterator(serialized_obj.begin()), std::move_iterator(serialized_obj.end()),
+                  std::back_inserter(serialized_objs));
+        total_size += serialized_obj.size();
+    }
+    std::vector<char> serialized_size = serialize_binary_size(total_size);
+    std::copy(std::move_iterator(serialized_objs.begin()), std::move_iterator(serialized_objs.end()),
+              std::back_inserter(serialized_size));
+    return serialized_size;
+}
+
+inline void legacy_deserialize(const char *ptr, MapperInput& obj) {
+    ptr += sizeof(std::size_t);
+    obj.setInput(deserialize_binary_attribute<std::string>(ptr).first);
+}
+
+inline void legacy_deserialize(const char *ptr, Result<std::string,int>& obj) {
+    ptr += sizeof(std::size_t);
+    auto key = deserialize_binary_attribute<std::string>(ptr);
+    ptr += key.second;
+    obj = Result<std::string,int>(key.first, deserialize_binary_attribute<int>(ptr).first);
+}
+
+inline void legacy_deserialize(const char *ptr, ReducerInput<std::string,std::string,std::string>& obj) {
+    ptr += sizeof(std::size_t);
+    auto key = deserialize_binary_attribute<std::string>(ptr);
+    ptr += key.second;
+    auto value = deserialize_binary_attribute<std::string>(ptr);
+    ptr += value.second;
+    obj = ReducerInput<std::string,std::string,std::string>(key.first, value.first,
+                                                            deserialize_binary_attribute<std::string>(ptr).first);
+}
+
+template<typename T>
+std::vector<T> legacy_deserialize(const char *ptr) {
+    std::vector<T> objs;
+    std::size_t total_size = deserialize_binary_size(ptr), nused = 0;
+    ptr += sizeof(total_size);
+    while (nused < total_size) {
+        std::size_t size_obj = deserialize_binary_size(ptr);
+        T t;
+        legacy_deserialize(ptr, t);
+        objs.push_back(t);
+        ptr += sizeof(size_obj) + size_obj;
+        nused += sizeof(size_obj) + size_obj;
+    }
+    return objs;
+}
@@ -0,0 +1,30 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <string_view>
+#include <optional>
+#include "LogRecord.h"
+
+// Mapper input of a shared scan on the log (map_reduce_shared_scan()): setInput() tokenizes the line once, and every
+// query maps the same record. The line and the record are views on the file, valid during the calls of the maps.
+class LogInput {
+    std::string_view input;
+    LogRecord record;
+
+public:
+    // false if the line is not in Common Log Format: the shared scan counts it and skips it
+    bool setInput(std::string_view line) {
+        std::optional<LogRecord> parsed = LogRecord::parse(line);
+        if (!parsed)
+            return false;
+        input = line;
+        record = *parsed;
+        return true;
+    }
+
+    std::string_view getInput() const { return input; }
+    const LogRecord& getRecord() const { return record; }
+};
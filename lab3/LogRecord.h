@@ -0,0 +1,89 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <string_view>
+#include <optional>
+#include <cstring>
+
+// Fields of a line of an access log in Common Log Format, e.g.
+//     209.17.96.34 - - [01/Jan/2020:00:19:59 +0100] "GET / HTTP/1.1" 200 20744
+// as views on the line: parse() does not allocate, so the line must outlive the record.
+// The request is taken up to the last '"' of the line, so that a '"' in the URL does not cut it. The delimiters are
+// found with memchr()/memrchr(), which glibc already implements with SIMD instructions.
+struct LogRecord {
+    std::string_view ip, ident, user;
+    std::string_view day, month, year, hour, minute, second, zone;     // timestamp
+    std::string_view request, method, url, protocol;
+    std::string_view status, bytes;
+
+    // nullopt if the line is not in Common Log Format
+    static std::optional<LogRecord> parse(std::string_view line) {
+        LogRecord record;
+        const char *p = line.data(), *end = p + line.size();
+        while (end > p && (end[-1] == '\r' || end[-1] == '\n' || end[-1] == ' '))
+            end--;
+
+        // ip, ident and user, up to the timestamp
+        if (!token(p, end, ' ', record.ip) || !token(p, end, ' ', record.ident) || !token(p, end, ' ', record.user))
+            return std::nullopt;
+
+        // timestamp: [day/month/year:hour:minute:second zone]
+        if (p == end || *p++ != '[')
+            return std::nullopt;
+        if (!token(p, end, '/', record.day) || !token(p, end, '/', record.month) ||
+                !token(p, end, ':', record.year) || !token(p, end, ':', record.hour) ||
+                !token(p, end, ':', record.minute) || !token(p, end, ' ', record.second) ||
+                !token(p, end, ']', record.zone))
+            return std::nullopt;
+
+        // request, between the first '"' and the last one
+        if (end - p < 2 || *p++ != ' ' || *p++ != '"')
+            return std::nullopt;
+        const char *quote = static_cast<const char *>(::memrchr(p, '"', end - p));
+        if (quote == nullptr)
+            return std::nullopt;
+        record.request = std::string_view(p, quote - p);
+        splitRequest(record);
+        p = quote + 1;
+
+        // status and bytes
+        if (p == end || *p++ != ' ' || !token(p, end, ' ', record.status))
+            return std::nullopt;
+        record.bytes = std::string_view(p, end - p);
+        if (record.status.empty() || record.bytes.empty())
+            return std::nullopt;
+        return record;
+    }
+
+private:
+    // field up to the delimiter, which is skipped
+    static bool token(const char *& p, const char *end, char delimiter, std::string_view& field) {
+        const char *d = static_cast<const char *>(std::memchr(p, delimiter, end - p));
+        if (d == nullptr)
+            return false;
+        field = std::string_view(p, d - p);
+        p = d + 1;
+        return true;
+    }
+
+    // method up to the first space, protocol after the last one, url in between (empty fields if missing)
+    static void splitRequest(LogRecord& record) {
+        std::string_view request = record.request;
+        std::size_t first = request.find(' ');
+        if (first == std::string_view::npos) {
+            record.method = request;
+            return;
+        }
+        record.method = request.substr(0, first);
+        std::size_t last = request.rfind(' ');
+        if (last == first) {
+            record.url = request.substr(first + 1);
+            return;
+        }
+        record.url = request.substr(first + 1, last - first - 1);
+        record.protocol = request.substr(last + 1);
+    }
+};
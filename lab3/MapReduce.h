@@ -0,0 +1,783 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <queue>
+#include <unordered_map>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <functional>
+#include <chrono>
+#include <span>
+#include <type_traits>
+#include <tuple>
+#include <utility>
+#include "Serializable.h"
+#include "Result.h"
+#include "Pipe.h"
+#include "ShmRing.h"
+#include "Poller.h"
+#include "MappedFile.h"
+#include "SpillTable.h"
+#include "PipeException.h"
+
+enum class Transport {
+    PIPE,               // Pipe
+    SHARED_MEMORY       // ShmRing
+};
+
+enum class Multiplexer {
+    EPOLL,              // Poller, sleeps when there is nothing to do
+    SELECT              // PipeT::select(), busy-waits on the idle pipes ready for write
+};
+
+// Configuration of the multi-process engines
+struct MapReduceOptions {
+    BinaryFormat format = BinaryFormat::SIZE_T;     // format on the pipes
+    Transport transport = Transport::PIPE;          // multiplexed only
+    Multiplexer multiplexer = Multiplexer::EPOLL;   // multiplexed only
+    unsigned int n_mappers = 1;                     // multiplexed only
+    unsigned int n_reducers = 1;                    // multiplexed only, each one owns the keys with hash % n_reducers
+    unsigned int batch_size = 1;                    // multiplexed only, records per message
+    std::chrono::milliseconds flush_timeout{10};    // multiplexed only, max wait of a record in an incomplete batch
+    std::size_t combine_size = 65536;               // combiner only, max keys in a mapper table before a flush
+    bool stateful_reducers = false;                 // reducers keep the accumulators, sent only at the end
+    std::size_t split_size = 1 << 18;               // multiplexed on a MappedFile only, bytes per InputSplit
+    std::size_t spill_budget = 0;                   // bytes of accumulators per reducer before spilling to disk
+                                                    // (0: never), implies stateful reducers (see SpillTable)
+    std::string spill_directory = "/tmp";           // spilling only, directory of the temporary files
+    std::size_t zero_copy_threshold = 0;            // pipes only, min bytes of a message payload to send it with
+                                                    // vmsplice() (0: never), see Pipe::setZeroCopy()
+};
+
+// Spilling: a later partial accumulator of a key is folded in the accumulator by the reduce function, as a value.
+// Only for reductions where a partial accumulator is a valid value, as for a combiner.
+template<typename ReducerInputT, typename K, typename A, typename R>
+auto merge_partials(R& reduce_fun) {
+    return [&reduce_fun](const K& key, A& acc, const A& partial) {
+        ReducerInputT reducer_input(key, partial, acc);
+        acc = reduce_fun(reducer_input).getValue();
+    };
+}
+
+// Combiner placeholder for the engines run without one
+struct NoCombiner {};
+
+/************
+ * Messages *
+ ************/
+
+// Sends objs as one message, the same as serialize_binary(objs, format), without building it: the size header and the
+// payload go with one gathered write. The payload is the memory of objs itself if they are copied in bulk,
+// otherwise they are serialized in writer, whose buffer is reused from message to message (or, if the pipe splices
+// it, exchanged with one the reader is done with).
+template<typename T, typename PipeT>
+void write_binary(PipeT& pipe, std::span<const T> objs, BinaryWriter& writer) {
+    char header[max_varint_size];
+    if constexpr (is_bulk_serializable<T>) {
+        if (writer.getFormat() == BinaryFormat::VARINT_FIXED) {
+            std::span<const char> payload(reinterpret_cast<const char *>(objs.data()), objs.size() * sizeof(T));
+            pipe.write({std::span<const char>(header, size_encode(payload.size(), writer.getFormat(), header)),
+                        payload});
+            return;
+        }
+    }
+    writer.clear();
+    for (const auto& obj : objs)
+        obj.serializeBinary(writer);
+    std::vector<char> payload;
+    writer.swapBuffer(payload);
+    pipe.writeSpliced(std::span<const char>(header, size_encode(payload.size(), writer.getFormat(), header)), payload);
+    writer.swapBuffer(payload);
+}
+
+template<typename T, typename PipeT>
+void write_binary(PipeT& pipe, const std::vector<T>& objs, BinaryWriter& writer) {
+    write_binary(pipe, std::span<const T>(objs), writer);
+}
+
+// one object as one message, as obj.serializeBinary(format)
+template<typename T, typename PipeT>
+void write_object(PipeT& pipe, const T& obj, BinaryWriter& writer) {
+    writer.clear();
+    obj.serializeBinary(writer);
+    pipe.write({std::span<const char>(writer.data(), writer.size())});
+}
+
+// Receives a message of objects in buffer, reused from message to message (see PipeT::read())
+template<typename T, typename PipeT>
+std::vector<T> read_binary(PipeT& pipe, std::vector<char>& buffer, BinaryFormat format) {
+    BinaryReader reader(pipe.read(buffer, format), format);
+    return deserialize_binary<T>(reader);
+}
+
+template<typename MapperInputT, typename ReducerInputT, typename ResultT, typename K, typename A, typename M, typename R>
+std::vector<ResultT> map_reduce_single_process(std::istream& input, M& map_fun, R& reduce_fun,
+        const MapReduceOptions& options = {}) {
+    SpillTable<K,A> accs(options.spill_budget, options.spill_directory,
+                         merge_partials<ReducerInputT, K, A>(reduce_fun));
+    MapperInputT mapper_input;
+
+    while (input >> mapper_input) {
+        std::vector<ResultT> mapper_results = map_fun(mapper_input);
+        for (const auto& mr : mapper_results) {
+            accs.update(mr.getKey(), [&](A& acc) {
+                ReducerInputT reducer_input(mr.getKey(), mr.getValue(), acc);
+                acc = reduce_fun(reducer_input).getValue();
+            });
+        }
+    }
+
+    // map to vector
+    std::vector<ResultT> results;
+    accs.forEach([&results](const K& key, A&& acc) {
+        results.push_back(ResultT(key, std::move(acc)));
+    });
+    return results;
+}
+
+// Stateful reducers: a reducer sends its accumulators as results when its input ends, in messages of
+// stateful_batch_size records
+constexpr std::size_t stateful_batch_size = 4096;
+
+template<typename ResultT, typename K, typename A, typename PipeT>
+void send_accs(PipeT& pipe, SpillTable<K,A>& accs, BinaryFormat format) {
+    std::vector<ResultT> results;
+    BinaryWriter writer(format);
+    accs.forEach([&](const K& key, A&& acc) {
+        results.push_back(ResultT(key, std::move(acc)));
+        if (results.size() == stateful_batch_size) {
+            write_binary(pipe, results, writer);
+            results.clear();
+        }
+    });
+    if (!results.empty())
+        write_binary(pipe, results, writer);
+}
+
+// With stateful reducers, the coordinator sends to the reducer the results of the mapper as they are, without waiting
+template<typename MapperInputT, typename ReducerInputT, typename ResultT, typename K, typename A, typename M, typename R>
+std::vector<ResultT> map_reduce_multi_process_synchronous(std::istream& input, M& map_fun, R& reduce_fun,
+        const MapReduceOptions& options = {}) {
+    const BinaryFormat format = options.format;
+    const bool stateful = options.stateful_reducers || options.spill_budget > 0;
+    std::unordered_map<K,A> accs;
+    SpillTable<K,A> reducer_accs(options.spill_budget, options.spill_directory,     // stateful reducer
+                                 merge_partials<ReducerInputT, K, A>(reduce_fun));
+    MapperInputT mapper_input;
+    ReducerInputT reducer_input;
+    std::vector<ResultT> mapper_results;
+    ResultT reducer_result;
+    std::span<const char> message;
+    std::vector<char> read_buffer;                  // reused by the reads
+    BinaryWriter writer(format);                    // reused by the writes
+    Pipe pipe_cm, pipe_mc, pipe_cr, pipe_rc;
+    pid_t pid, pid_mapper;
+    for (Pipe *pipe : {&pipe_cm, &pipe_mc, &pipe_cr, &pipe_rc})
+        pipe->setZeroCopy(options.zero_copy_threshold);
+
+    /**********
+     * Mapper *
+     **********/
+    pid = fork();
+    if (!pid) {
+        pipe_cr.close();
+        pipe_rc.close();
+        pipe_cm.closeWrite();
+        pipe_mc.closeRead();
+        while (true) {
+            try {
+                mapper_input.deserializeBinary(pipe_cm.read(read_buffer, format).data(), format);
+                mapper_results = map_fun(mapper_input);
+                write_binary(pipe_mc, mapper_results, writer);
+            } catch (PipeException e) {
+                if (e.isEOF())
+                    std::exit(EXIT_SUCCESS);    // input terminated => all done for the mapper
+                else throw;
+            }
+        }
+    } else if (pid < 0) {
+        throw std::runtime_error("error - fork() failed");
+    }
+    pid_mapper = pid;
+
+    /***********
+     * Reducer *
+     ***********/
+    pid = fork();
+    if (!pid) {
+        pipe_cm.close();
+        pipe_mc.close();
+        pipe_cr.closeWrite();
+        pipe_rc.closeRead();
+        while (true) {
+            try {
+                if (stateful) {
+                    for (const auto& mr : read_binary<ResultT>(pipe_cr, read_buffer, format)) {
+                        reducer_accs.update(mr.getKey(), [&](A& acc) {
+                            reducer_input = ReducerInputT(mr.getKey(), mr.getValue(), acc);
+                            acc = reduce_fun(reducer_input).getValue();
+                        });
+                    }
+                    continue;
+                }
+                reducer_input.deserializeBinary(pipe_cr.read(read_buffer, format).data(), format);
+                reducer_result = reduce_fun(reducer_input);
+                write_object(pipe_rc, reducer_result, writer);
+            } catch (PipeException e) {
+                if (!e.isEOF()) throw;
+                if (stateful)
+                    send_accs<ResultT>(pipe_rc, reducer_accs, format);
+                std::exit(EXIT_SUCCESS);    // input terminated => all done for the reducer
+            }
+        }
+    } else if (pid < 0) {
+        throw std::runtime_error("error - fork() failed");
+    }
+
+    /***************
+     * Coordinator *
+     ***************/
+    pipe_cm.closeRead();
+    pipe_mc.closeWrite();
+    pipe_cr.closeRead();
+    pipe_rc.closeWrite();
+
+    while (input >> mapper_input) {
+        // communicate with mapper
+        write_object(pipe_cm, mapper_input, writer);
+        message = pipe_mc.read(read_buffer, format);
+
+        // stateful reducer: forward the results as they are
+        if (stateful) {
+            pipe_cr.write({message});
+            continue;
+        }
+        BinaryReader reader(message, format);
+        mapper_results = deserialize_binary<ResultT>(reader);
+
+        // communicate with reducer
+        for (const auto& mr : mapper_results) {
+            reducer_input = ReducerInputT(mr.getKey(), mr.getValue(), accs[mr.getKey()]);
+            write_object(pipe_cr, reducer_input, writer);
+            reducer_result.deserializeBinary(pipe_rc.read(read_buffer, format).data(), format);
+            accs[reducer_result.getKey()] = reducer_result.getValue();
+        }
+    }
+
+    // all done for the workers, get the accumulators of the stateful reducer (final, each key once)
+    std::vector<ResultT> results;
+    pipe_cm.close();
+    pipe_cr.close();
+    while (stateful) {
+        try {
+            for (auto& r : read_binary<ResultT>(pipe_rc, read_buffer, format))
+                results.push_back(std::move(r));
+        } catch (PipeException e) {
+            if (e.isEOF()) break;
+            else throw;
+        }
+    }
+    pipe_mc.close();
+    pipe_rc.close();
+    waitpid(pid_mapper, nullptr, 0);
+    waitpid(pid, nullptr, 0);
+
+    // map to vector
+    for (const auto& acc : accs)
+        results.push_back(ResultT(acc.first, acc.second));
+    return results;
+}
+
+// PipeT: transport between coordinator and workers (Pipe or ShmRing)
+// InputT: std::istream, whose lines are sent to the mappers, or MappedFile, whose InputSplit are sent to the mappers
+// that read the lines in the file mapping (MapperInputT::setInput(std::string_view)), batch_size lines at a time
+// C: combiner (or NoCombiner), with the signature of reduce_fun. Each mapper reduces its results in a local table
+// and sends the partial accumulators as values, when the table is full (combine_size), older than flush_timeout or
+// at the end. Only for reductions where a partial accumulator is a valid value, e.g. counting or summing.
+template<typename PipeT, typename MapperInputT, typename ReducerInputT, typename ResultT, typename K, typename A,
+        typename InputT, typename M, typename C, typename R>
+std::vector<ResultT> map_reduce_multi_process_multiplexed_over(InputT& input, M& map_fun, C& combine_fun,
+        R& reduce_fun, const MapReduceOptions& options = {}) {
+    constexpr bool combining = !std::is_same_v<C, NoCombiner>;
+    constexpr bool splitting = std::is_same_v<std::remove_const_t<InputT>, MappedFile>;
+    const bool stateful = options.stateful_reducers || options.spill_budget > 0;
+    const BinaryFormat format = options.format;
+    const unsigned int n_mappers = std::max(options.n_mappers, 1u);
+    const unsigned int n_reducers = std::max(options.n_reducers, 1u);
+    const std::size_t batch_size = std::max(options.batch_size, 1u);
+    std::unordered_map<K,A> accs;
+    SpillTable<K,A> reducer_accs(options.spill_budget, options.spill_directory,
+                                 merge_partials<ReducerInputT, K, A>(reduce_fun));
+    MapperInputT mapper_input;
+    ReducerInputT reducer_input;
+    std::vector<MapperInputT> mapper_inputs;
+    std::vector<std::vector<ResultT>> mapper_results(n_reducers);    // by reducer owning the key
+    std::vector<std::chrono::steady_clock::time_point> mapper_results_since(n_reducers);
+    std::vector<ResultT> results_in, results_out;
+    ResultT result;
+    std::vector<char> read_buffer;                  // reused by the reads
+    BinaryWriter writer(format);                    // reused by the writes
+    std::vector<std::shared_ptr<PipeT>> pipes_cm, pipes_mc, pipes_cr, pipes_rc, pipes;
+    std::vector<pid_t> pids;
+    std::vector<InputSplit> splits;
+    std::size_t next_split = 0;
+    std::vector<ResultT> results;
+    if constexpr (splitting)
+        splits = input.split(options.split_size);
+    pid_t pid;
+
+    // create pipes
+    auto create_pipes = [&pipes, &options](std::vector<std::shared_ptr<PipeT>>& group, unsigned int n) {
+        for (unsigned int i=0; i<n; i++) {
+            group.push_back(std::make_shared<PipeT>());
+            group.back()->setZeroCopy(options.zero_copy_threshold);
+            pipes.push_back(group.back());
+        }
+    };
+    create_pipes(pipes_cm, n_mappers);
+    create_pipes(pipes_mc, n_mappers);
+    create_pipes(pipes_cr, n_reducers);
+    create_pipes(pipes_rc, n_reducers);
+
+    // in a worker, keep only the read end of pipe_in and the write end of pipe_out
+    auto close_others = [&pipes](const std::shared_ptr<PipeT>& pipe_in, const std::shared_ptr<PipeT>& pipe_out) {
+        for (const auto& pipe : pipes)
+            if (pipe != pipe_in && pipe != pipe_out)
+                pipe->close();
+        pipe_in->closeWrite();
+        pipe_out->closeRead();
+    };
+
+    auto all_close = [](const std::vector<std::shared_ptr<PipeT>>& group) {
+        return std::all_of(group.begin(), group.end(), [](const std::shared_ptr<PipeT>& p) { return p->isClose(); });
+    };
+
+    /***********
+     * Mappers *
+     ***********/
+    std::unordered_map<K,A> partials;                   // combiner: partial accumulators by key
+    std::chrono::steady_clock::time_point partials_since;
+    auto flush_partials = [&]() {
+        for (auto& partial : partials)
+            results_out.push_back(ResultT(partial.first, std::move(partial.second)));
+        partials.clear();
+    };
+
+    // map (and combine) one record, to results_out or partials
+    auto map_record = [&](const MapperInputT& mi) {
+        std::vector<ResultT> mapper_new_results = map_fun(mi);
+        if constexpr (combining) {
+            if (partials.empty())
+                partials_since = std::chrono::steady_clock::now();
+            for (const auto& r : mapper_new_results) {
+                A& partial = partials[r.getKey()];
+                reducer_input = ReducerInputT(r.getKey(), r.getValue(), partial);
+                partial = combine_fun(reducer_input).getValue();
+            }
+        } else {
+            results_out.insert(results_out.end(), mapper_new_results.begin(), mapper_new_results.end());
+        }
+    };
+
+    // at the end of a batch of records: send the results (or the partials, if it is time)
+    auto send_results = [&](PipeT& pipe) {
+        if constexpr (combining) {
+            if (partials.size() >= options.combine_size ||
+                    std::chrono::steady_clock::now() - partials_since >= options.flush_timeout)
+                flush_partials();
+        }
+        if (!results_out.empty()) {
+            write_binary(pipe, results_out, writer);
+            results_out.clear();
+        }
+    };
+
+    for (unsigned int i=0; i<n_mappers; i++) {
+        pid = fork();
+        if (!pid) {
+            close_others(pipes_cm[i], pipes_mc[i]);
+            while (true) {
+                try {
+                    results_out.clear();
+                    if constexpr (splitting) {
+                        for (const auto& split : read_binary<InputSplit>(*pipes_cm[i], read_buffer, format)) {
+                            std::size_t n_lines = 0;
+                            MappedFile::forEachLine(input.view(split), [&](std::string_view line) {
+                                mapper_input.setInput(line);
+                                map_record(mapper_input);
+                                if (++n_lines % batch_size == 0)
+                                    send_results(*pipes_mc[i]);
+                            });
+                            send_results(*pipes_mc[i]);
+                            input.release(split);
+                        }
+                    } else {
+                        mapper_inputs = read_binary<MapperInputT>(*pipes_cm[i], read_buffer, format);
+                        for (const auto& mi : mapper_inputs)
+                            map_record(mi);
+                        send_results(*pipes_mc[i]);
+                    }
+                } catch (PipeException e) {
+                    if (!e.isEOF()) throw;
+                    if constexpr (combining) {
+                        results_out.clear();
+                        flush_partials();
+                        if (!results_out.empty())
+                            write_binary(*pipes_mc[i], results_out, writer);
+                    }
+                    std::exit(EXIT_SUCCESS);    // input terminated => all done for the mapper
+                }
+            }
+        } else if (pid < 0) {
+            throw std::runtime_error("error - fork() failed");
+        }
+        pids.push_back(pid);
+    }
+
+    /************
+     * Reducers *
+     ************/
+    for (unsigned int i=0; i<n_reducers; i++) {
+        pid = fork();
+        if (!pid) {
+            close_others(pipes_cr[i], pipes_rc[i]);
+            while (true) {
+                try {
+                    results_in = read_binary<ResultT>(*pipes_cr[i], read_buffer, format);
+                    results_out.clear();
+                    for (const auto& r : results_in) {
+                        reducer_accs.update(r.getKey(), [&](A& acc) {
+                            reducer_input = ReducerInputT(r.getKey(), r.getValue(), acc);
+                            result = reduce_fun(reducer_input);
+                            acc = result.getValue();
+                        });
+                        if (!stateful)
+                            results_out.push_back(result);
+                    }
+                    if (!stateful)
+                        write_binary(*pipes_rc[i], results_out, writer);
+                } catch (PipeException e) {
+                    if (!e.isEOF()) throw;
+                    if (stateful)
+                        send_accs<ResultT>(*pipes_rc[i], reducer_accs, format);
+                    std::exit(EXIT_SUCCESS);    // input terminated => all done for the reducer
+                }
+            }
+        } else if (pid < 0) {
+            throw std::runtime_error("error - fork() failed");
+        }
+        pids.push_back(pid);
+    }
+
+    /***************
+     * Coordinator *
+     ***************/
+    for (unsigned int i=0; i<n_mappers; i++) {
+        pipes_cm[i]->closeRead();
+        pipes_mc[i]->closeWrite();
+        pipes_cm[i]->setNonblocking();
+    }
+    for (unsigned int i=0; i<n_reducers; i++) {
+        pipes_cr[i]->closeRead();
+        pipes_rc[i]->closeWrite();
+        pipes_cr[i]->setNonblocking();
+    }
+
+    Poller<PipeT> poller;
+    for (const auto& pipe : pipes)
+        poller.add(pipe);
+
+    // Sleep only if the last round did nothing (no event to handle), at most up to the next batch timeout
+    bool progress = true;
+    auto wait_timeout = [&]() {
+        if (progress)
+            return 0;
+        int timeout_ms = -1;
+        auto now = std::chrono::steady_clock::now();
+        for (unsigned int i=0; i<n_reducers; i++) {
+            if (!mapper_results[i].empty()) {
+                auto left = mapper_results_since[i] + options.flush_timeout - now;
+                int left_ms = static_cast<int>(std::max<long>(
+                        std::chrono::ceil<std::chrono::milliseconds>(left).count(), 0));
+                timeout_ms = timeout_ms < 0 ? left_ms : std::min(timeout_ms, left_ms);
+            }
+        }
+        return timeout_ms;
+    };
+
+    while (!all_close(pipes)) {
+        if (options.multiplexer == Multiplexer::SELECT)
+            PipeT::select(pipes);
+        else
+            poller.wait(wait_timeout());
+        progress = false;
+
+        // send work to mappers, one batch of lines (or one split) to each ready one (round-robin)
+        for (const auto& pipe_cm : pipes_cm) {
+            if (pipe_cm->isReadyWrite()) {
+                progress = true;
+                if constexpr (splitting) {
+                    if (next_split < splits.size()) {
+                        write_binary(*pipe_cm, std::span<const InputSplit>(&splits[next_split++], 1), writer);
+                        continue;
+                    }
+                } else {
+                    mapper_inputs.clear();
+                    while (mapper_inputs.size() < batch_size && input >> mapper_input)
+                        mapper_inputs.push_back(mapper_input);
+                    if (!mapper_inputs.empty()) {
+                        write_binary(*pipe_cm, mapper_inputs, writer);
+                        continue;
+                    }
+                }
+                for (const auto& p : pipes_cm)
+                    p->close();     // all done for mappers (after the pending batches)
+                break;
+            }
+        }
+
+        // get (one!) batch of results from each mapper, partitioned by key hash
+        for (const auto& pipe_mc : pipes_mc) {
+            if (pipe_mc->isReadyRead()) {
+                progress = true;
+                try {
+                    results_in = read_binary<ResultT>(*pipe_mc, read_buffer, format);
+                    for (auto& r : results_in) {
+                        std::size_t i = std::hash<K>{}(r.getKey()) % n_reducers;
+                        if (mapper_results[i].empty())
+                            mapper_results_since[i] = std::chrono::steady_clock::now();
+                        mapper_results[i].push_back(std::move(r));
+                    }
+                } catch (PipeException e) {
+                    if (e.isEOF()) pipe_mc->close();
+                    else throw;
+                }
+            }
+        }
+
+        // send work to reducers: full batches, then the rest if it waited too much or the mappers are done
+        bool mappers_done = all_close(pipes_cm) && all_close(pipes_mc);
+        auto now = std::chrono::steady_clock::now();
+        for (unsigned int i=0; i<n_reducers; i++) {
+            if (pipes_cr[i]->isReadyWrite()) {
+                std::span<const ResultT> pending(mapper_results[i]);
+                std::size_t sent = 0;
+                progress = progress || pending.size() >= batch_size;
+                for (; pending.size() - sent >= batch_size; sent += batch_size)
+                    write_binary(*pipes_cr[i], pending.subspan(sent, batch_size), writer);
+                if (sent < pending.size() && (mappers_done || now - mapper_results_since[i] >= options.flush_timeout)) {
+                    write_binary(*pipes_cr[i], pending.subspan(sent), writer);
+                    sent = pending.size();
+                    progress = true;
+                }
+                mapper_results[i].erase(mapper_results[i].begin(), mapper_results[i].begin() + sent);
+
+                if (mapper_results[i].empty() && mappers_done) {
+                    pipes_cr[i]->close();   // all done for reducer (after the pending batches)
+                    progress = true;
+                }
+            }
+        }
+
+        // get results from reducers (disjoint keys, each one once if stateful)
+        for (const auto& pipe_rc : pipes_rc) {
+            if (pipe_rc->isReadyRead()) {
+                progress = true;
+                try {
+                    for (auto& r : read_binary<ResultT>(*pipe_rc, read_buffer, format)) {
+                        if (stateful)
+                            results.push_back(std::move(r));
+                        else
+                            accs[r.getKey()] = r.getValue();
+                    }
+                } catch (PipeException e) {
+                    if (e.isEOF()) pipe_rc->close();
+                    else throw;
+                }
+            }
+        }
+    }
+
+    // wait for the workers
+    for (pid_t worker : pids)
+        waitpid(worker, nullptr, 0);
+
+    // map to vector
+    for (const auto& acc : accs)
+        results.push_back(ResultT(acc.first, acc.second));
+    return results;
+}
+
+// with a combiner (see map_reduce_multi_process_multiplexed_over()), on a std::istream or a MappedFile
+template<typename MapperInputT, typename ReducerInputT, typename ResultT, typename K, typename A, typename InputT,
+        typename M, typename C, typename R>
+std::vector<ResultT> map_reduce_multi_process_multiplexed(InputT& input, M& map_fun, C& combine_fun,
+        R& reduce_fun, const MapReduceOptions& options) {
+    if (options.transport == Transport::SHARED_MEMORY)
+        return map_reduce_multi_process_multiplexed_over<ShmRing, MapperInputT, ReducerInputT, ResultT, K, A>
+                (input, map_fun, combine_fun, reduce_fun, options);
+    return map_reduce_multi_process_multiplexed_over<Pipe, MapperInputT, ReducerInputT, ResultT, K, A>
+            (input, map_fun, combine_fun, reduce_fun, options);
+}
+
+// on a std::istream or a MappedFile
+template<typename MapperInputT, typename ReducerInputT, typename ResultT, typename K, typename A, typename InputT,
+        typename M, typename R>
+std::vector<ResultT> map_reduce_multi_process_multiplexed(InputT& input, M& map_fun, R& reduce_fun,
+        const MapReduceOptions& options = {}) {
+    NoCombiner no_combiner;
+    return map_reduce_multi_process_multiplexed<MapperInputT, ReducerInputT, ResultT, K, A>
+            (input, map_fun, no_combiner, reduce_fun, options);
+}
+
+// One (map, reduce) pair of a shared scan, see map_reduce_shared_scan()
+template<typename ReducerInputT, typename ResultT, typename K, typename A, typename M, typename R>
+struct Query {
+    typedef ReducerInputT ReducerInputType;
+    typedef ResultT ResultType;
+    typedef K KeyType;
+    typedef A AccType;
+
+    M& map_fun;
+    R& reduce_fun;
+};
+
+template<typename ReducerInputT, typename ResultT, typename K, typename A, typename M, typename R>
+Query<ReducerInputT, ResultT, K, A, M, R> make_query(M& map_fun, R& reduce_fun) {
+    return {map_fun, reduce_fun};
+}
+
+// Runs several queries (of different types) in one pass on the file: each worker (n_mappers) gets a contiguous range
+// of lines, builds each MapperInputT once and feeds it to every query, reducing in a table per query (SpillTable,
+// with spill_budget). At the end it sends the tables, query after query, and the coordinator merges them in the order
+// of the ranges with the reduce functions: the same assumption as for a combiner (see merge_partials()).
+// If MapperInputT::setInput() returns a bool, it may reject a line (false, e.g. LogInput when the line does not
+// parse): the line is fed to no query and counted in n_rejected. Returns the results of each query.
+template<typename MapperInputT, typename... Q>
+std::tuple<std::vector<typename Q::ResultType>...> map_reduce_shared_scan(const MappedFile& input,
+        const MapReduceOptions& options, std::size_t& n_rejected, const Q&... queries) {
+    typedef Result<std::string, std::size_t> RejectedT;     // count of a worker, after its tables
+    const BinaryFormat format = options.format;
+    const unsigned int n_workers = std::max(options.n_mappers, 1u);
+    const std::vector<InputSplit> splits = input.split((input.getSize() + n_workers - 1) / n_workers);
+    const auto query_list = std::forward_as_tuple(queries...);
+    constexpr auto query_indexes = std::index_sequence_for<Q...>{};
+    std::vector<std::shared_ptr<Pipe>> pipes;       // worker -> coordinator
+    std::vector<pid_t> pids;
+    pid_t pid;
+
+    for (std::size_t i=0; i<splits.size(); i++) {
+        pipes.push_back(std::make_shared<Pipe>());
+        pipes.back()->setZeroCopy(options.zero_copy_threshold);
+    }
+
+    /***********
+     * Workers *
+     ***********/
+    for (std::size_t i=0; i<splits.size(); i++) {
+        pid = fork();
+        if (!pid) {
+            for (std::size_t j=0; j<pipes.size(); j++)
+                if (j != i)
+                    pipes[j]->close();
+            pipes[i]->closeRead();
+
+            auto tables = std::make_tuple(std::make_unique<SpillTable<typename Q::KeyType, typename Q::AccType>>(
+                    options.spill_budget, options.spill_directory,
+                    merge_partials<typename Q::ReducerInputType, typename Q::KeyType, typename Q::AccType>
+                            (queries.reduce_fun))...);
+            MapperInputT mapper_input;
+            std::size_t worker_rejected = 0;
+
+            auto feed = [&mapper_input](const auto& query, auto& table) {
+                typedef std::decay_t<decltype(query)> QueryT;
+                for (const auto& r : query.map_fun(mapper_input)) {
+                    table.update(r.getKey(), [&](typename QueryT::AccType& acc) {
+                        typename QueryT::ReducerInputType reducer_input(r.getKey(), r.getValue(), acc);
+                        acc = query.reduce_fun(reducer_input).getValue();
+                    });
+                }
+            };
+            MappedFile::forEachLine(input.view(splits[i]), [&](std::string_view line) {
+                if constexpr (std::is_same_v<decltype(mapper_input.setInput(line)), bool>) {
+                    if (!mapper_input.setInput(line)) {
+                        worker_rejected++;
+                        return;
+                    }
+                } else {
+                    mapper_input.setInput(line);
+                }
+                [&]<std::size_t... I>(std::index_sequence<I...>) {
+                    (feed(std::get<I>(query_list), *std::get<I>(tables)), ...);
+                }(query_indexes);
+            });
+            input.release(splits[i]);
+
+            // the tables, each one terminated by an empty message
+            BinaryWriter writer(format);
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                ((send_accs<typename Q::ResultType>(*pipes[i], *std::get<I>(tables), format),
+                  write_binary(*pipes[i], std::vector<typename Q::ResultType>(), writer)), ...);
+            }(query_indexes);
+            write_binary(*pipes[i], std::vector<RejectedT>{RejectedT("rejected", worker_rejected)}, writer);
+            std::exit(EXIT_SUCCESS);
+        } else if (pid < 0) {
+            throw std::runtime_error("error - fork() failed");
+        }
+        pids.push_back(pid);
+    }
+
+    /***************
+     * Coordinator *
+     ***************/
+    std::tuple<std::unordered_map<typename Q::KeyType, typename Q::AccType>...> accs;
+    for (auto& pipe : pipes)
+        pipe->closeWrite();
+
+    std::vector<char> read_buffer;
+    auto merge_table = [&format, &read_buffer](Pipe& pipe, const auto& query, auto& query_accs) {
+        typedef std::decay_t<decltype(query)> QueryT;
+        auto merge = merge_partials<typename QueryT::ReducerInputType, typename QueryT::KeyType,
+                typename QueryT::AccType>(query.reduce_fun);
+        while (true) {
+            std::vector<typename QueryT::ResultType> results = read_binary<typename QueryT::ResultType>
+                    (pipe, read_buffer, format);
+            if (results.empty())
+                return;
+            for (const auto& r : results) {
+                auto [it, inserted] = query_accs.try_emplace(r.getKey(), r.getValue());
+                if (!inserted)
+                    merge(r.getKey(), it->second, r.getValue());
+            }
+        }
+    };
+    n_rejected = 0;
+    for (auto& pipe : pipes) {      // in the order of the ranges
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (merge_table(*pipe, std::get<I>(query_list), std::get<I>(accs)), ...);
+        }(query_indexes);
+        for (const auto& rejected : read_binary<RejectedT>(*pipe, read_buffer, format))
+            n_rejected += rejected.getValue();
+        pipe->close();
+    }
+
+    // wait for the workers
+    for (pid_t worker : pids)
+        waitpid(worker, nullptr, 0);
+
+    // maps to vectors
+    std::tuple<std::vector<typename Q::ResultType>...> results;
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        ([&]() {
+            for (auto& acc : std::get<I>(accs))
+                std::get<I>(results).push_back(typename Q::ResultType(acc.first, std::move(acc.second)));
+        }(), ...);
+    }(query_indexes);
+    return results;
+}
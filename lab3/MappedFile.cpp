@@ -0,0 +1,74 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#include "MappedFile.h"
+#include <stdexcept>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string& path): ptr(nullptr), size(0) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("error - cannot open " + path);
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        ::close(fd);
+        throw std::runtime_error("error - fstat() failed");
+    }
+    size = st.st_size;
+
+    if (size > 0) {     // mmap() fails on empty files
+        void *memory = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (memory == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("error - mmap() failed");
+        }
+        ::madvise(memory, size, MADV_SEQUENTIAL);
+        ptr = static_cast<const char *>(memory);
+    }
+    ::close(fd);        // the mapping stays
+}
+
+MappedFile::~MappedFile() {
+    if (ptr != nullptr)
+        ::munmap(const_cast<char *>(ptr), size);
+}
+
+std::string_view MappedFile::view(const InputSplit& split) const {
+    if (split.getOffset() + split.getLength() > size)
+        throw std::out_of_range("error - split out of the file");
+    return std::string_view(ptr + split.getOffset(), split.getLength());
+}
+
+// Drops the pages of a split done with from the resident memory of the process (read again from the file if needed),
+// so that a mapper going through a file bigger than the memory does not keep it all
+void MappedFile::release(const InputSplit& split) const {
+    const std::size_t page = ::sysconf(_SC_PAGESIZE);
+    std::size_t start = (split.getOffset() + page - 1) / page * page;      // whole pages only, the others are shared
+    std::size_t end = (split.getOffset() + split.getLength()) / page * page;
+    if (start < end)
+        ::madvise(const_cast<char *>(ptr) + start, end - start, MADV_DONTNEED);
+}
+
+// about split_size bytes each, up to the end of the line
+std::vector<InputSplit> MappedFile::split(std::size_t split_size) const {
+    std::vector<InputSplit> splits;
+    std::size_t start = 0;
+
+    split_size = std::max<std::size_t>(split_size, 1);
+    while (start < size) {
+        std::size_t end = std::min(start + split_size, size);
+        if (end < size) {
+            auto newline = static_cast<const char *>(std::memchr(ptr + end - 1, '\n', size - end + 1));
+            end = newline != nullptr ? newline - ptr + 1 : size;
+        }
+        splits.emplace_back(start, end - start);
+        start = end;
+    }
+    return splits;
+}
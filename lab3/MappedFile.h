@@ -0,0 +1,42 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "InputSplit.h"
+
+// Read-only memory mapping of a whole file, to be created before fork(): the processes share the pages, so a mapper
+// given an InputSplit parses its lines in place and the file content never crosses a pipe.
+class MappedFile {
+    const char *ptr;
+    std::size_t size;
+
+    MappedFile(const MappedFile& other) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+public:
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    std::size_t getSize() const { return size; }
+    std::string_view view(const InputSplit& split) const;
+    void release(const InputSplit& split) const;
+    std::vector<InputSplit> split(std::size_t split_size) const;
+
+    // calls fun on each line of text, without '\n', as std::getline() until EOF
+    template<typename F>
+    static void forEachLine(std::string_view text, F fun) {
+        while (!text.empty()) {
+            std::size_t end = text.find('\n');
+            if (end == std::string_view::npos) {
+                fun(text);
+                return;
+            }
+            fun(text.substr(0, end));
+            text.remove_prefix(end + 1);
+        }
+    }
+};
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <sstream>
@@ -13,8 +14,14 @@
 class MapperInput: public Serializable<MapperInput> {
     std::string input;
 
+    static constexpr auto fields() {
+        return std::make_tuple(field("input", &MapperInput::input));
+    }
+    friend class Serializable<MapperInput>;
+
 public:
-    std::string getInput() const { return input; }
+    const std::string& getInput() const { return input; }
+    void setInput(std::string_view input) { this->input.assign(input); }
 
     friend std::istream& operator>>(std::istream& in, MapperInput& mapperInput) {
         std::getline(in, mapperInput.input);
@@ -25,31 +32,4 @@ public:
         out << mapperInput.input;
         return out;
     }
-
-    pt::ptree buildPTree() const {
-        pt::ptree pt;
-        pt.put("input", input);
-        return pt;
-    }
-
-    void loadPTree(const pt::ptree& pt) {
-        input = pt.get<std::string>("input");
-    }
-
-    std::vector<char> serializeBinary() const {
-        std::size_t total_size = sizeof(std::size_t) + input.size();    // input size + input
-        std::vector<char> serialized_obj = serialize_binary_size(total_size);
-        std::vector<char> tmp = serialize_binary_attribute(input);
-        std::copy(tmp.begin(), tmp.end(), std::back_inserter(serialized_obj));
-        return serialized_obj;
-    }
-
-    void deserializeBinary(std::shared_ptr<char[]> serialized_obj) {
-        deserializeBinary(serialized_obj.get());
-    }
-
-    void deserializeBinary(const char *serialized_obj) {
-        serialized_obj += sizeof(std::size_t);   // skip total size
-        input = deserialize_binary_attribute<std::string>(serialized_obj).first;
-    }
 };
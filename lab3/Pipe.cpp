@@ -5,20 +5,188 @@
 #include "Pipe.h"
 #include "PipeException.h"
 #include <unistd.h>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <cerrno>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <sys/epoll.h>
+#include <poll.h>
 
-Pipe::Pipe(): readyRead(false), readyWrite(false) {
+Pipe::Pipe(): readyRead(false), readyWrite(false), nonblocking(false), closePending(false), readable(false), hup(false),
+             outboxPosition(0), zeroCopyThreshold(0), written(0) {
     if (::pipe(fd) < 0)
         throw PipeException("pipe() failed");
 }
 
 Pipe::~Pipe() {
+    outbox.clear();     // pending bytes are lost
+    closePending = false;
     close();
 }
 
+// The write end does not block: write() queues what does not fit in the pipe, select() sends it when possible
+// (the pipe is not ready for write until the queue is empty) and closeWrite() is deferred until then.
+// Needed by the coordinator with big batches, that would otherwise block on a worker blocked on its results.
+void Pipe::setNonblocking() {
+    int flags = fcntl(fd[1], F_GETFL);
+    if (flags < 0 || fcntl(fd[1], F_SETFL, flags | O_NONBLOCK) < 0)
+        throw PipeException("fcntl() failed");
+    nonblocking = true;
+}
+
 void Pipe::write(const std::vector<char>& content) {
-    if (::write(fd[1], reinterpret_cast<const char *>(&content[0]), content.size()) <= 0)
-        throw PipeException("write() failed");
+    write({std::span<const char>(content)});
+}
+
+// One message from several segments (e.g. size header and payload) with writev(), without joining them first.
+// In nonblocking mode, only what does not fit in the pipe is copied to the outbox.
+void Pipe::write(std::initializer_list<std::span<const char>> segments) {
     readyWrite = false;
+
+    if (nonblocking && hasPending()) {      // after the pending bytes
+        for (const auto& segment : segments)
+            outbox.insert(outbox.end(), segment.begin(), segment.end());
+        flush();
+        return;
+    }
+
+    struct iovec iov[max_segments];
+    int iovcnt = 0;
+    if (segments.size() > max_segments)
+        throw PipeException("too many segments");
+    for (const auto& segment : segments)
+        if (!segment.empty())
+            iov[iovcnt++] = {const_cast<char *>(segment.data()), segment.size()};
+
+    struct iovec *next = iov;
+    ssize_t nwritten;
+    while (iovcnt > 0) {
+        if ((nwritten = ::writev(fd[1], next, iovcnt)) < 0) {
+            if (errno == EINTR)
+                continue;
+            else if (errno == EAGAIN)
+                break;      // pipe full (nonblocking mode)
+            else
+                throw PipeException("writev() failed");
+        }
+        written += nwritten;
+        for (; iovcnt > 0 && static_cast<size_t>(nwritten) >= next->iov_len; iovcnt--, next++)
+            nwritten -= static_cast<ssize_t>(next->iov_len);
+        if (iovcnt > 0) {       // partial write
+            next->iov_base = static_cast<char *>(next->iov_base) + nwritten;
+            next->iov_len -= nwritten;
+        }
+    }
+
+    for (; iovcnt > 0; iovcnt--, next++) {  // the rest
+        const char *base = static_cast<const char *>(next->iov_base);
+        outbox.insert(outbox.end(), base, base + next->iov_len);
+    }
+}
+
+// Zero-copy mode, for big messages: writeSpliced() moves the pages of payloads of at least threshold bytes into the
+// pipe with vmsplice() instead of copying them. The pipe only references the pages, so a payload is kept (inFlight)
+// until the reader has read it, i.e. until the bytes in the pipe (FIONREAD) are fewer than those written after it.
+// Below the threshold the copy is cheaper than the pages to reference (see benchmark.cpp).
+// The payloads are not page-aligned (BinaryWriter buffers): the pipe references the range of each page holding the
+// payload, so the first and last pages may be shared with other objects without harm, only with a partial page more.
+// Blocking mode only: closeWrite() waits for the reader to read the spliced payloads, a nonblocking writer copies.
+void Pipe::setZeroCopy(size_t threshold) {
+    zeroCopyThreshold = threshold;
+}
+
+// Writes header (copied) and payload as one message. If the payload is spliced, it is moved into the pipe and
+// replaced with a spliced payload already read (or an empty vector), to be reused by the caller.
+void Pipe::writeSpliced(std::span<const char> header, std::vector<char>& payload) {
+    if (zeroCopyThreshold == 0 || payload.size() < zeroCopyThreshold || nonblocking) {
+        write({header, std::span<const char>(payload)});
+        return;
+    }
+    write({header});
+
+    struct iovec iov = {payload.data(), payload.size()};
+    ssize_t nwritten;
+    while (iov.iov_len > 0) {
+        if ((nwritten = ::vmsplice(fd[1], &iov, 1, 0)) < 0) {
+            if (errno == EINTR)
+                continue;
+            else
+                throw PipeException("vmsplice() failed");
+        }
+        iov.iov_base = static_cast<char *>(iov.iov_base) + nwritten;
+        iov.iov_len -= nwritten;
+        written += nwritten;
+    }
+
+    reclaim();
+    inFlight.emplace_back(written, std::move(payload));
+    payload.clear();
+    if (!spare.empty()) {
+        payload = std::move(spare.back());
+        spare.pop_back();
+    }
+}
+
+// spliced payloads already read by the reader to spare
+void Pipe::reclaim() {
+    if (inFlight.empty())
+        return;
+    int n = 0;
+    if (::ioctl(fd[1], FIONREAD, &n) < 0)
+        throw PipeException("ioctl() failed");
+    while (!inFlight.empty() && inFlight.front().first <= written - n) {
+        spare.push_back(std::move(inFlight.front().second));
+        spare.back().clear();
+        inFlight.pop_front();
+    }
+}
+
+// Before the write end is closed, waits for the reader to read the spliced payloads: freed earlier, their pages could
+// be given to new objects, that would overwrite the bytes still in the pipe. No event tells that the pipe is empty,
+// so FIONREAD is checked every millisecond. Stops waiting if no reader is left (POLLERR): nobody will read them.
+void Pipe::waitInFlight() {
+    while (true) {
+        reclaim();
+        if (inFlight.empty())
+            return;
+        struct pollfd pfd = {fd[1], 0, 0};
+        if (::poll(&pfd, 1, 1) < 0 && errno != EINTR)
+            throw PipeException("poll() failed");
+        if (pfd.revents & POLLERR) {
+            inFlight.clear();
+            return;
+        }
+    }
+}
+
+void Pipe::flush() {
+    ssize_t nwritten;
+
+    while (outboxPosition < outbox.size()) {
+        if ((nwritten = ::write(fd[1], outbox.data() + outboxPosition, outbox.size() - outboxPosition)) < 0) {
+            if (errno == EINTR)
+                continue;
+            else if (errno == EAGAIN)
+                return;     // pipe full
+            else
+                throw PipeException("write() failed");
+        }
+        outboxPosition += nwritten;
+        written += nwritten;
+    }
+
+    outbox.clear();
+    outboxPosition = 0;
+    if (closePending) {
+        closePending = false;
+        closeWrite();
+    }
+}
+
+bool Pipe::hasPending() {
+    return !outbox.empty();
 }
 
 void Pipe::read(char *ptr, size_t n) {
@@ -39,19 +207,53 @@ void Pipe::read(char *ptr, size_t n) {
     }
 }
 
-std::shared_ptr<char []> Pipe::read() {
-    size_t total_size;
+// Reads the size header of a message, returns the size of the whole message. With VARINT, after the first byte the
+// rest of the header is read with one read(): a header longer than 1 byte means a payload of at least 128 bytes, so
+// max_varint_size - 1 bytes never go past the message. header gets the nread bytes read (maybe some of the payload).
+size_t Pipe::readHeader(char *header, size_t& nread, BinaryFormat format) {
+    if (format == BinaryFormat::SIZE_T) {
+        nread = sizeof(size_t);
+        read(header, nread);
+    } else {
+        nread = 1;
+        read(header, 1);
+        if (header[0] & 0x80) {
+            read(header + 1, max_varint_size - 1);
+            nread = max_varint_size;
+            if (std::all_of(header, header + nread, [](char byte) { return byte & 0x80; }))
+                throw PipeException("invalid size header");
+        }
+    }
+    return BinaryReader::objectSize(header, format);
+}
+
+std::shared_ptr<char []> Pipe::read(BinaryFormat format) {
+    char header[max_varint_size];
+    size_t nread, message_size = readHeader(header, nread, format);
 
-    read(reinterpret_cast<char *>(&total_size), sizeof(total_size));
-    std::shared_ptr<char[]> ptr(new char[sizeof(total_size) + total_size]);
-    for (int i=0; i<sizeof(total_size); i++)    // copy total size here
-        ptr[i] = reinterpret_cast<char *>(&total_size)[i];
-    read(ptr.get() + sizeof(total_size), total_size);
+    std::shared_ptr<char[]> ptr(new char[message_size]);
+    std::memcpy(ptr.get(), header, nread);      // copy total size here
+    read(ptr.get() + nread, message_size - nread);
 
     readyRead = false;
     return ptr;
 }
 
+// Reads a message into buffer, grown as needed and reused from call to call: no allocation once it is big enough.
+// Returns the message, valid until the next read into buffer.
+std::span<const char> Pipe::read(std::vector<char>& buffer, BinaryFormat format) {
+    char header[max_varint_size];
+    size_t nread, message_size = readHeader(header, nread, format);
+
+    if (buffer.size() < message_size)
+        buffer.resize(message_size);
+    std::memcpy(buffer.data(), header, nread);
+    read(buffer.data() + nread, message_size - nread);
+
+    readyRead = false;
+    return {buffer.data(), message_size};
+}
+
 bool Pipe::isReadyRead() {
     return readyRead;
 }
@@ -72,6 +274,13 @@ void Pipe::closeRead() {
 }
 
 void Pipe::closeWrite() {
+    if (hasPending()) {
+        closePending = true;    // closed by flush()
+        readyWrite = false;
+        return;
+    }
+    if (fd[1] != INVALID_FD)
+        waitInFlight();
     ::close(fd[1]);
     fd[1] = INVALID_FD;
     readyWrite = false;
@@ -88,6 +297,8 @@ void Pipe::select(const std::vector<std::shared_ptr<Pipe>>& pipes) {
     FD_ZERO(&rset);
     FD_ZERO(&wset);
     for (const auto& pipe : pipes) {
+        if (pipe->fd[0] >= FD_SETSIZE || pipe->fd[1] >= FD_SETSIZE)
+            throw PipeException("too many file descriptors for select()");
         if (pipe->fd[0] != INVALID_FD)
             FD_SET(pipe->fd[0], &rset);
         if (pipe->fd[1] != INVALID_FD)
@@ -98,9 +309,58 @@ void Pipe::select(const std::vector<std::shared_ptr<Pipe>>& pipes) {
     if (::select(FD_SETSIZE, &rset, &wset, NULL, NULL) < 0)
         throw PipeException("select() failed");
     for (auto& pipe : pipes) {
-        if (FD_ISSET(pipe->fd[0], &rset))
+        if (pipe->fd[0] != INVALID_FD && FD_ISSET(pipe->fd[0], &rset))
             pipe->readyRead = true;
-        if (FD_ISSET(pipe->fd[1], &wset))
-            pipe->readyWrite = true;
+        if (pipe->fd[1] != INVALID_FD && FD_ISSET(pipe->fd[1], &wset)) {
+            if (pipe->hasPending())
+                pipe->flush();
+            pipe->readyWrite = pipe->fd[1] != INVALID_FD && !pipe->hasPending() && !pipe->closePending;
+        }
+    }
+}
+
+int Pipe::readEventFd() const {
+    return fd[0];
+}
+
+int Pipe::writeEventFd() const {
+    return fd[1];
+}
+
+uint32_t Pipe::writeEventMask() {
+    return EPOLLOUT;
+}
+
+// Edge-triggered: an event comes only when new bytes arrive, so the pipe stays ready for read as long as there are
+// bytes left (FIONREAD) or the write end has been closed (EOF still to be read). Returns whether ready for read.
+bool Pipe::updateRead(bool event, bool hangup) {
+    if (fd[0] == INVALID_FD)
+        return false;
+    if (event)
+        readable = true;
+    if (hangup)
+        hup = true;
+
+    if (readable && !readyRead) {
+        int n = 0;
+        if (::ioctl(fd[0], FIONREAD, &n) < 0)
+            throw PipeException("ioctl() failed");
+        if (n > 0 || hup)
+            readyRead = true;
+        else
+            readable = false;
     }
+    return readyRead;
+}
+
+// Flushes the pending bytes (the write end does not block, so with or without a write event). Ready for write (i.e. to
+// accept a new message) when nothing is pending. Returns whether there are still pending bytes, i.e. whether write
+// events are needed.
+bool Pipe::updateWrite(bool /*event*/) {
+    if (fd[1] == INVALID_FD)
+        return false;
+    if (hasPending())
+        flush();
+    readyWrite = fd[1] != INVALID_FD && !hasPending() && !closePending;
+    return fd[1] != INVALID_FD && hasPending();
 }
@@ -6,22 +6,46 @@
 
 #include "Serializable.h"
 #include <vector>
+#include <span>
+#include <initializer_list>
+#include <deque>
+#include <cstdint>
 
 #define INVALID_FD -1
 
 class Pipe {
+    static constexpr size_t max_segments = 8;   // per write()
+
     int fd[2];
     bool readyRead, readyWrite;
+    bool nonblocking, closePending;
+    bool readable, hup;                 // Poller: edge seen and not known to be drained, write end closed
+    std::vector<char> outbox;           // nonblocking mode: bytes accepted by write() but not yet in the pipe
+    size_t outboxPosition;
+    size_t zeroCopyThreshold;           // zero-copy mode: min payload size for vmsplice() (0: never)
+    uint64_t written;                   // bytes put in the pipe so far
+    std::deque<std::pair<uint64_t, std::vector<char>>> inFlight;   // spliced payloads, by end position in the pipe
+    std::vector<std::vector<char>> spare;                           // spliced payloads already read, to reuse
 
     Pipe(const Pipe& other) = delete;
     Pipe& operator=(const Pipe& other) = delete;
     void read(char *ptr, size_t n);
+    size_t readHeader(char *header, size_t& nread, BinaryFormat format);
+    void flush();
+    void reclaim();
+    void waitInFlight();
 
 public:
     Pipe();
     ~Pipe();
+    void setNonblocking();
     void write(const std::vector<char>& content);
-    std::shared_ptr<char[]> read();
+    void write(std::initializer_list<std::span<const char>> segments);
+    void setZeroCopy(size_t threshold);
+    void writeSpliced(std::span<const char> header, std::vector<char>& payload);
+    bool hasPending();
+    std::shared_ptr<char[]> read(BinaryFormat format = BinaryFormat::SIZE_T);
+    std::span<const char> read(std::vector<char>& buffer, BinaryFormat format = BinaryFormat::SIZE_T);
     bool isReadyRead();
     bool isReadyWrite();
     void close();
@@ -29,6 +53,13 @@ public:
     void closeWrite();
     bool isClose();
     static void select(const std::vector<std::shared_ptr<Pipe>>& pipes);
+
+    // Poller interface
+    int readEventFd() const;
+    int writeEventFd() const;
+    static uint32_t writeEventMask();
+    bool updateRead(bool event, bool hangup = false);
+    bool updateWrite(bool event);
 };
 
 
@@ -0,0 +1,92 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include "PipeException.h"
+#include <vector>
+#include <memory>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/epoll.h>
+
+// Edge-triggered epoll multiplexer over a set of pipes (Pipe or ShmRing), registered once with add().
+// Unlike PipeT::select(), an idle pipe never wakes it up: the read ends are always registered, while the write ends
+// only while they have pending bytes (nonblocking mode). Ready for write, as for select(), means nothing pending.
+// Being edge-triggered, the readiness for read is kept by the pipes themselves (updateRead()) until drained.
+template<typename PipeT>
+class Poller {
+    int epfd;
+    std::vector<std::shared_ptr<PipeT>> pipes;
+    std::vector<bool> writeRegistered;
+    std::vector<struct epoll_event> events;
+
+    Poller(const Poller& other) = delete;
+    Poller& operator=(const Poller& other) = delete;
+
+    // event data: index of the pipe and side (0 read, 1 write)
+    void control(int op, int fd, uint32_t mask, std::size_t i, int side) {
+        struct epoll_event event = {};
+        event.events = mask | EPOLLET;
+        event.data.u64 = i * 2 + side;
+        if (::epoll_ctl(epfd, op, fd, &event) < 0)
+            throw PipeException("epoll_ctl() failed");
+    }
+
+    void setWriteInterest(std::size_t i, bool interest) {
+        if (interest == writeRegistered[i])
+            return;
+        int fd = pipes[i]->writeEventFd();
+        if (interest)
+            control(EPOLL_CTL_ADD, fd, PipeT::writeEventMask(), i, 1);
+        else if (fd >= 0)
+            ::epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        // else: already closed, removed by the kernel (or ignored in wait() if a child still has it)
+        writeRegistered[i] = interest;
+    }
+
+public:
+    Poller() {
+        epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epfd < 0)
+            throw PipeException("epoll_create1() failed");
+    }
+
+    ~Poller() {
+        ::close(epfd);
+    }
+
+    void add(const std::shared_ptr<PipeT>& pipe) {
+        pipes.push_back(pipe);
+        writeRegistered.push_back(false);
+        events.resize(pipes.size() * 2);
+        if (pipe->readEventFd() >= 0)
+            control(EPOLL_CTL_ADD, pipe->readEventFd(), EPOLLIN, pipes.size() - 1, 0);
+    }
+
+    // Updates the readiness of the pipes, waiting up to timeout_ms (-1: forever) for some event if none is ready
+    // for read. Pipes ready for write do not stop the wait: the caller uses timeout 0 if it has work to do.
+    void wait(int timeout_ms) {
+        bool ready = false;
+        for (std::size_t i=0; i<pipes.size(); i++) {
+            ready = pipes[i]->updateRead(false) || ready;
+            setWriteInterest(i, pipes[i]->updateWrite(false));
+        }
+
+        int n = ::epoll_wait(epfd, events.data(), static_cast<int>(events.size()), ready ? 0 : timeout_ms);
+        if (n < 0) {
+            if (errno == EINTR)
+                return;
+            throw PipeException("epoll_wait() failed");
+        }
+
+        for (int k=0; k<n; k++) {
+            std::size_t i = events[k].data.u64 / 2;
+            if (events[k].data.u64 % 2 == 0)
+                pipes[i]->updateRead(true, events[k].events & (EPOLLHUP | EPOLLERR));
+            else
+                setWriteInterest(i, pipes[i]->updateWrite(true));
+        }
+    }
+};
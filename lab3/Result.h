@@ -14,64 +14,19 @@ class Result: public Serializable<Result<K,V>> {
     K key;
     V value;
 
-    // helper function for binary serialization (specialized for std::string, see below)
-    std::size_t getKeySize() { return sizeof(key); }
+    static constexpr auto fields() {
+        return std::make_tuple(field("key", &Result::key), field("value", &Result::value));
+    }
+    friend class Serializable<Result>;
 
 public:
     Result() {}
-    Result(K key, V value): key(key), value(value) {}
-    K getKey() const { return key; }
-    V getValue() const { return value; }
+    Result(K key, V value): key(std::move(key)), value(std::move(value)) {}
+    const K& getKey() const { return key; }
+    const V& getValue() const { return value; }
 
     friend std::ostream& operator<<(std::ostream& out, const Result& result) {
         out << result.key << " => " << result.value;
         return out;
     }
-
-    pt::ptree buildPTree() const {
-        pt::ptree pt;
-        pt.put("key", key);
-        pt.put("value", value);
-        return pt;
-    }
-
-    void loadPTree(const pt::ptree& pt) {
-        key = pt.get<K>("key");
-        value = pt.get<V>("value");
-    }
-
-    std::vector<char> serializeBinary() const {
-        std::vector<char> tmp, serialized_obj;
-        std::size_t total_size = 2*sizeof(std::size_t) + key.size() + sizeof(value);
-        serialized_obj = serialize_binary_size(total_size);     // total size
-        tmp = serialize_binary_attribute(key);                  // key
-        std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
-        tmp = serialize_binary_attribute(value);                // value
-        std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
-        return serialized_obj;
-    }
-
-    void deserializeBinary(std::shared_ptr<char[]> serialized_obj) {
-        deserializeBinary(serialized_obj.get());
-    }
-
-    void deserializeBinary(const char *serialized_obj) {
-        serialized_obj += sizeof(std::size_t);   // skip total size
-        std::pair<K,std::size_t> key_res = deserialize_binary_attribute<K>(serialized_obj);
-        key = key_res.first;
-        serialized_obj += key_res.second;
-        value = deserialize_binary_attribute<V>(serialized_obj).first;
-    }
 };
-
-template<>
-inline std::vector<char> Result<std::string,std::string>::serializeBinary() const {
-    std::vector<char> tmp, serialized_obj;
-    std::size_t total_size = 2*sizeof(std::size_t) + key.size() + value.size();
-    serialized_obj = serialize_binary_size(total_size);     // total size
-    tmp = serialize_binary_attribute(key);                  // key
-    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
-    tmp = serialize_binary_attribute(value);                // value
-    std::copy(std::move_iterator(tmp.begin()), std::move_iterator(tmp.end()), std::back_inserter(serialized_obj));
-    return serialized_obj;
-}
@@ -6,52 +6,165 @@
 
 #include <vector>
 #include <memory>
+#include <span>
+#include <tuple>
+#include <type_traits>
+#include <stdexcept>
+#include <cstring>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include "BinaryWriter.h"
+#include "BinaryReader.h"
+#include "JsonWriter.h"
+#include "JsonReader.h"
 
 namespace pt = boost::property_tree;
 
+/*********************
+ * Field descriptors *
+ *********************/
+
+// named pointer to a data member, the unit of T::fields()
+template<typename C, typename M>
+struct Field {
+    const char *name;
+    M C::*member;
+};
+
+template<typename C, typename M>
+constexpr Field<C,M> field(const char *name, M C::*member) {
+    return Field<C,M>{name, member};
+}
+
+// T declares its serialized attributes once:
+//     static constexpr auto fields() { return std::make_tuple(field("key", &T::key), ...); }
+// and the base generates the JSON and binary codecs from them (Serializable<T> must be a friend if fields() is private)
 template<typename T>
 class Serializable {
     Serializable() {}
     friend T;
 
+    template<typename F>
+    static void forEachField(F&& f) {
+        std::apply([&f](const auto&... field) { (f(field), ...); }, T::fields());
+    }
+
+    template<typename M>
+    static constexpr bool fixedField(const Field<T,M>&) {
+        return std::is_trivially_copyable_v<M>;
+    }
+
+    template<typename M>
+    static constexpr std::size_t fieldSize(const Field<T,M>&, BinaryFormat format) {
+        return (format == BinaryFormat::SIZE_T ? sizeof(std::size_t) : 0) + sizeof(M);
+    }
+
+    template<typename M>
+    static constexpr bool arithmeticField(const Field<T,M>&) {
+        return std::is_arithmetic_v<M>;
+    }
+
+    template<typename M>
+    static constexpr std::size_t memberSize(const Field<T,M>&) {
+        return sizeof(M);
+    }
+
+    static constexpr std::size_t fixedPayloadSize(BinaryFormat format) {
+        return std::apply([format](const auto&... field) { return (fieldSize(field, format) + ... + 0); }, T::fields());
+    }
+
 public:
+    // true if all the attributes are trivially copyable, i.e. the binary size is known at compile time
+    // (except for BinaryFormat::VARINT, where integral attributes have variable length)
+    static constexpr bool isFixedSize() {
+        return std::apply([](const auto&... field) { return (fixedField(field) && ...); }, T::fields());
+    }
+
+    static constexpr bool isFixedSize(BinaryFormat format) {
+        return isFixedSize() && format != BinaryFormat::VARINT;
+    }
+
+    // true if the attributes are all arithmetic and fill T without padding, i.e. the memory of T holds only them
+    static constexpr bool isPacked() {
+        return std::apply([](const auto&... field) {
+            return (arithmeticField(field) && ...) && (memberSize(field) + ... + 0) == sizeof(T);
+        }, T::fields());
+    }
+
+    // binary size of a fixed-size object, total size included
+    static constexpr std::size_t fixedBinarySize(BinaryFormat format = BinaryFormat::SIZE_T) {
+        static_assert(isFixedSize(), "object has variable-size attributes");
+        if (format == BinaryFormat::VARINT)
+            throw std::invalid_argument("fixedBinarySize: integral attributes have variable length");
+        std::size_t payload = fixedPayloadSize(format);
+        return (format == BinaryFormat::SIZE_T ? sizeof(std::size_t) : varint_size(payload)) + payload;
+    }
+
     /*********************************
      * JSON serialization with boost *
      *********************************/
 
     pt::ptree buildPTree() const {
-        return static_cast<T const&>(*this).getPTree();
+        pt::ptree pt;
+        forEachField([&](const auto& field) { pt.put(field.name, self().*field.member); });
+        return pt;
     }
 
     void loadPTree(const pt::ptree& pt) {
-        return static_cast<T const&>(*this).loadPTree(pt);
+        forEachField([&](const auto& field) {
+            auto& member = self().*field.member;
+            member = pt.get<std::remove_reference_t<decltype(member)>>(field.name);
+        });
     }
 
+    /**********************************************
+     * Streaming JSON (same output as write_json) *
+     **********************************************/
+
     std::vector<char> serializeJSON() const {
-        pt::ptree pt = static_cast<T const&>(*this).buildPTree();
-        std::ostringstream oss;
-        pt::write_json(oss, pt);
-        std::string s(oss.str());
-        return std::vector<char>(s.begin(), s.end());
+        JsonWriter writer;
+        serializeJSON(writer);
+        writer.finish();
+        return writer.release();
+    }
+
+    void serializeJSON(JsonWriter& writer) const {
+        writer.beginObject();
+        forEachField([&](const auto& field) {
+            writer.key(field.name);
+            writer.value(self().*field.member);
+        });
+        writer.endObject();
     }
 
     void serializeJSON(pt::ptree& array) const {
-        pt::ptree pt = static_cast<T const&>(*this).buildPTree();
-        array.push_back(std::make_pair("", pt));
+        array.push_back(std::make_pair("", buildPTree()));
     }
 
     void deserializeJSON(std::shared_ptr<char[]> serialized_obj) {
-        std::string s{serialized_obj.get()};
-        std::istringstream iss(s);
-        pt::ptree pt;
-        pt::read_json(iss, pt);
-        deserializeJSON(pt);
+        JsonReader reader(serialized_obj.get(), std::strlen(serialized_obj.get()));
+        deserializeJSON(reader);
+    }
+
+    // members can be in any order, unknown ones are skipped
+    void deserializeJSON(JsonReader& reader) {
+        std::string_view key;
+        reader.beginObject();
+        while (reader.nextMember(key)) {
+            bool found = false;
+            forEachField([&](const auto& field) {
+                if (!found && key == field.name) {
+                    reader.read(self().*field.member);
+                    found = true;
+                }
+            });
+            if (!found)
+                reader.skipValue();
+        }
     }
 
     void deserializeJSON(const pt::ptree& pt) {
-        static_cast<T&>(*this).loadPTree(pt);
+        loadPTree(pt);
     }
 
 
@@ -59,17 +172,45 @@ public:
      * Binary serialization *
      ************************/
 
-    std::vector<char> serializeBinary() const {
-        return static_cast<T const&>(*this).serializeBinary();
+    std::vector<char> serializeBinary(BinaryFormat format = BinaryFormat::SIZE_T) const {
+        BinaryWriter writer(format);
+        if constexpr (isFixedSize())
+            if (isFixedSize(format))
+                writer.reserve(fixedBinarySize(format));
+        serializeBinary(writer);
+        return writer.release();
     }
 
-    void deserializeBinary(std::shared_ptr<char[]> serialized_obj) {
-        static_cast<T&>(*this).deserializeBinary(serialized_obj);
+    void serializeBinary(BinaryWriter& writer) const {
+        if constexpr (isFixedSize()) {
+            if (isFixedSize(writer.getFormat())) {
+                writer.writeSize(fixedPayloadSize(writer.getFormat()));
+                forEachField([&](const auto& field) { writer.write(self().*field.member); });
+                return;
+            }
+        }
+        std::size_t object = writer.beginObject();
+        forEachField([&](const auto& field) { writer.write(self().*field.member); });
+        writer.endObject(object);
     }
 
-    void deserializeBinary(const char *serialized_obj) {
-        static_cast<T&>(*this).deserializeBinary(serialized_obj);
+    void deserializeBinary(std::shared_ptr<char[]> serialized_obj, BinaryFormat format = BinaryFormat::SIZE_T) {
+        deserializeBinary(serialized_obj.get(), format);
     }
+
+    void deserializeBinary(const char *serialized_obj, BinaryFormat format = BinaryFormat::SIZE_T) {
+        BinaryReader reader(serialized_obj, BinaryReader::objectSize(serialized_obj, format), format);
+        deserializeBinary(reader);
+    }
+
+    void deserializeBinary(BinaryReader& reader) {
+        reader.readSize();      // skip total size
+        forEachField([&](const auto& field) { reader.read(self().*field.member); });
+    }
+
+private:
+    T& self() { return static_cast<T&>(*this); }
+    const T& self() const { return static_cast<const T&>(*this); }
 };
 
 /*********************************
@@ -78,6 +219,49 @@ public:
 
 template<typename T>
 std::vector<char> serialize_json(const std::vector<T>& objs) {
+    JsonWriter writer;
+    writer.beginObject();
+    writer.key("array");
+    if (objs.empty()) {
+        writer.value("");       // as ptree, an empty array is an empty value
+    } else {
+        writer.beginArray();
+        for (const auto& obj : objs) {
+            writer.element();
+            obj.serializeJSON(writer);
+            if (&obj == &objs.front())      // guess the total size from the first object
+                writer.reserve(writer.size() * objs.size() * 5 / 4);
+        }
+        writer.endArray();
+    }
+    writer.endObject();
+    writer.finish();
+    return writer.release();
+}
+
+template<typename T>
+std::vector<T> deserialize_json(std::shared_ptr<char[]> serialized_objs) {
+    JsonReader reader(serialized_objs.get(), std::strlen(serialized_objs.get()));
+    std::vector<T> objs;
+    std::string_view key;
+    reader.beginObject();
+    while (reader.nextMember(key)) {
+        if (key != "array" || reader.isString()) {
+            reader.skipValue();
+            continue;
+        }
+        reader.beginArray();
+        while (reader.nextElement()) {
+            objs.emplace_back();
+            objs.back().deserializeJSON(reader);
+        }
+    }
+    return objs;
+}
+
+// same as serialize_json/deserialize_json, through a ptree
+template<typename T>
+std::vector<char> serialize_json_ptree(const std::vector<T>& objs) {
     pt::ptree root, array;
     for (auto& obj : objs)
         obj.serializeJSON(array);
@@ -89,7 +273,7 @@ std::vector<char> serialize_json(const std::vector<T>& objs) {
 }
 
 template<typename T>
-std::vector<T> deserialize_json(std::shared_ptr<char[]> serialized_objs) {
+std::vector<T> deserialize_json_ptree(std::shared_ptr<char[]> serialized_objs) {
     std::string s{serialized_objs.get()};
     std::istringstream iss(s);
     pt::ptree root;
@@ -138,44 +322,80 @@ std::pair<A, std::size_t> deserialize_binary_attribute(const char *serialized_a)
  * Binary serialization of vectors *
  ***********************************/
 
+// Vectors of packed objects (T::isPacked(), e.g. Result<int,int>) are copied in bulk in BinaryFormat::VARINT_FIXED:
+// total size + the raw array. Otherwise, and in the other formats, they are serialized object by object.
 template<typename T>
-std::vector<char> serialize_binary(const std::vector<T>& objs) {
-    std::vector<char> serialized_objs;
-    std::size_t total_size = 0;
+constexpr bool is_bulk_serializable = false;
+
+template<typename T> requires (std::is_trivially_copyable_v<T> && T::isPacked())
+constexpr bool is_bulk_serializable<T> = true;
 
-    // objects
+template<typename T>
+void serialize_binary(std::span<const T> objs, BinaryWriter& writer) {
+    if constexpr (is_bulk_serializable<T>) {
+        if (writer.getFormat() == BinaryFormat::VARINT_FIXED) {
+            writer.writeSize(objs.size() * sizeof(T));
+            writer.writeBytes(objs.data(), objs.size() * sizeof(T));
+            return;
+        }
+    }
+    std::size_t object = writer.beginObject();     // total size
     for (const auto& obj : objs) {
-        std::vector<char> serialized_obj = obj.serializeBinary();
-        std::copy(std::move_iterator(serialized_obj.begin()), std::move_iterator(serialized_obj.end()), std::back_inserter(serialized_objs));
-        total_size += serialized_obj.size();
+        std::size_t start = writer.size();
+        obj.serializeBinary(writer);
+        if (&obj == &objs.front())      // guess the total size from the first object
+            writer.reserve(writer.size() + (writer.size() - start) * (objs.size() - 1) * 5 / 4);
     }
+    writer.endObject(object);
+}
 
-    // total size
-    std::vector<char> serialized_size = serialize_binary_size(total_size);
-    std::copy(std::move_iterator(serialized_objs.begin()), std::move_iterator(serialized_objs.end()), std::back_inserter(serialized_size));
+template<typename T>
+std::vector<char> serialize_binary(std::span<const T> objs, BinaryFormat format = BinaryFormat::SIZE_T) {
+    BinaryWriter writer(format);
+    if constexpr (T::isFixedSize())
+        if (T::isFixedSize(format))     // enough for the bulk copy too
+            writer.reserve(max_varint_size + objs.size() * T::fixedBinarySize(format));
+    serialize_binary(objs, writer);
+    return writer.release();
+}
 
-    return serialized_size;
+// a vector is a span of all its objects
+template<typename T>
+void serialize_binary(const std::vector<T>& objs, BinaryWriter& writer) {
+    serialize_binary(std::span<const T>(objs), writer);
 }
 
 template<typename T>
-std::vector<T> deserialize_binary(std::shared_ptr<char[]> serialized_objs) {
+std::vector<char> serialize_binary(const std::vector<T>& objs, BinaryFormat format = BinaryFormat::SIZE_T) {
+    return serialize_binary(std::span<const T>(objs), format);
+}
+
+template<typename T>
+std::vector<T> deserialize_binary(BinaryReader& reader) {
     std::vector<T> objs;
-    char *ptr = serialized_objs.get();
-    std::size_t total_size, nused;
-
-    // total size
-    total_size = deserialize_binary_size(ptr);
-    ptr += sizeof(total_size);
-    nused=sizeof(total_size);
-
-    // objects
-    while (nused < total_size) {
-        std::size_t size_obj = deserialize_binary_size(ptr);
-        T t;
-        t.deserializeBinary(ptr);
-        objs.push_back(t);
-        ptr += sizeof(size_obj) + size_obj;
-        nused += sizeof(size_obj) + size_obj;
+    std::size_t size = reader.readSize();
+    if constexpr (is_bulk_serializable<T>) {
+        if (reader.getFormat() == BinaryFormat::VARINT_FIXED) {
+            if (size % sizeof(T) != 0)
+                throw std::out_of_range("deserialize_binary: size is not a multiple of the object size");
+            objs.resize(size / sizeof(T));
+            std::memcpy(objs.data(), reader.readBytes(size), size);
+            return objs;
+        }
+    }
+    if constexpr (T::isFixedSize())
+        if (T::isFixedSize(reader.getFormat()))
+            objs.reserve(size / T::fixedBinarySize(reader.getFormat()));
+    std::size_t end = reader.getPosition() + size;
+    while (reader.getPosition() < end) {
+        objs.emplace_back();
+        objs.back().deserializeBinary(reader);
     }
     return objs;
+}
+
+template<typename T>
+std::vector<T> deserialize_binary(std::shared_ptr<char[]> serialized_objs, BinaryFormat format = BinaryFormat::SIZE_T) {
+    BinaryReader reader(serialized_objs.get(), BinaryReader::objectSize(serialized_objs.get(), format), format);
+    return deserialize_binary<T>(reader);
 }
\ No newline at end of file
@@ -0,0 +1,422 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#include "ShmRing.h"
+#include "PipeException.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <csignal>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <sys/epoll.h>
+
+#define INVALID_FD -1
+
+ShmRing::ShmRing(size_t capacity): readOpen(true), writeOpen(true), readyRead(false), readyWrite(false), eof(false),
+                                   nonblocking(false), closePending(false), outboxPosition(0) {
+    this->capacity = 1;
+    while (this->capacity < capacity)
+        this->capacity <<= 1;
+
+    void *memory = ::mmap(nullptr, sizeof(Header) + this->capacity, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        throw PipeException("mmap() failed");
+    header = new (memory) Header{};
+    data = static_cast<char *>(memory) + sizeof(Header);
+
+    if (::pipe2(dataBell, O_NONBLOCK) < 0 || ::pipe2(spaceBell, O_NONBLOCK) < 0)
+        throw PipeException("pipe() failed");
+}
+
+ShmRing::~ShmRing() {
+    outbox.clear();     // pending bytes are lost
+    closePending = false;
+    close();
+    ::munmap(header, sizeof(Header) + capacity);
+}
+
+size_t ShmRing::available() const {
+    return header->head.load() - header->tail.load();
+}
+
+size_t ShmRing::space() const {
+    return capacity - available();
+}
+
+// one byte on a doorbell: it may be full (already rung) or closed (the other side is gone, no SIGPIPE)
+void ShmRing::ring(int fd) {
+    sigset_t sigpipe, old;
+    sigemptyset(&sigpipe);
+    sigaddset(&sigpipe, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &sigpipe, &old);
+
+    char c = 0;
+    if (::write(fd, &c, 1) < 0 && errno == EPIPE) {
+        struct timespec zero = {0, 0};
+        sigtimedwait(&sigpipe, nullptr, &zero);     // discard the SIGPIPE
+    }
+    pthread_sigmask(SIG_SETMASK, &old, nullptr);
+}
+
+// empties a doorbell, returns true on EOF
+bool ShmRing::drain(int fd) {
+    char buffer[64];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0 || (n < 0 && errno == EINTR));
+    return n == 0;
+}
+
+// copies up to n bytes in the ring (producer), returns the number of bytes copied
+size_t ShmRing::put(const char *ptr, size_t n) {
+    uint64_t head = header->head.load(std::memory_order_relaxed);
+    n = std::min(n, space());
+    if (n == 0)
+        return 0;
+
+    size_t offset = head & (capacity - 1);
+    size_t first = std::min(n, capacity - offset);
+    std::memcpy(data + offset, ptr, first);
+    std::memcpy(data, ptr + first, n - first);
+    header->head.store(head + n);
+
+    if (header->readerWaiting.load() && header->readerWaiting.exchange(false))
+        ring(dataBell[1]);
+    return n;
+}
+
+void ShmRing::waitData() {
+    while (true) {
+        header->readerWaiting.store(true);
+        if (available() > 0)
+            break;
+        if (eof) {
+            header->readerWaiting.store(false);
+            throw PipeException("write end closed", true);
+        }
+        struct pollfd pfd = {dataBell[0], POLLIN, 0};
+        if (::poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            throw PipeException("poll() failed");
+        if (drain(dataBell[0]))
+            eof = true;
+    }
+    header->readerWaiting.store(false);
+}
+
+void ShmRing::waitSpace() {
+    while (true) {
+        header->writerWaiting.store(true);
+        if (space() > 0)
+            break;
+        struct pollfd pfd = {spaceBell[0], POLLIN, 0};
+        if (::poll(&pfd, 1, -1) < 0 && errno != EINTR)
+            throw PipeException("poll() failed");
+        if (drain(spaceBell[0])) {
+            header->writerWaiting.store(false);
+            throw PipeException("write() failed");      // read end closed
+        }
+    }
+    header->writerWaiting.store(false);
+}
+
+// The write end does not block, as Pipe::setNonblocking()
+void ShmRing::setNonblocking() {
+    nonblocking = true;
+}
+
+void ShmRing::write(const std::vector<char>& content) {
+    write({std::span<const char>(content)});
+}
+
+// one message from several segments, as Pipe::write()
+void ShmRing::write(std::initializer_list<std::span<const char>> segments) {
+    readyWrite = false;
+
+    if (nonblocking && hasPending()) {      // after the pending bytes
+        for (const auto& segment : segments)
+            outbox.insert(outbox.end(), segment.begin(), segment.end());
+        flush();
+        return;
+    }
+
+    for (const auto& segment : segments) {
+        const char *ptr = segment.data();
+        size_t nleft = segment.size();
+        while (nleft > 0) {
+            size_t nwritten = put(ptr, nleft);
+            if (nwritten == 0) {
+                if (nonblocking)
+                    break;      // ring full
+                waitSpace();
+            }
+            nleft -= nwritten;
+            ptr += nwritten;
+        }
+        if (nleft > 0)          // the rest
+            outbox.insert(outbox.end(), ptr, ptr + nleft);
+    }
+}
+
+// Pipe zero-copy interface: the payload goes through the shared memory anyway, so it is always copied
+void ShmRing::setZeroCopy(size_t) {}
+
+void ShmRing::writeSpliced(std::span<const char> header, std::vector<char>& payload) {
+    write({header, std::span<const char>(payload)});
+}
+
+void ShmRing::flush() {
+    while (outboxPosition < outbox.size()) {
+        size_t nwritten = put(outbox.data() + outboxPosition, outbox.size() - outboxPosition);
+        if (nwritten == 0)
+            return;     // ring full
+        outboxPosition += nwritten;
+    }
+
+    outbox.clear();
+    outboxPosition = 0;
+    if (closePending) {
+        closePending = false;
+        closeWrite();
+    }
+}
+
+bool ShmRing::hasPending() {
+    return !outbox.empty();
+}
+
+void ShmRing::read(char *ptr, size_t n) {
+    while (n > 0) {
+        size_t navailable = available();
+        if (navailable == 0) {
+            waitData();
+            continue;
+        }
+
+        uint64_t tail = header->tail.load(std::memory_order_relaxed);
+        size_t nread = std::min(n, navailable);
+        size_t offset = tail & (capacity - 1);
+        size_t first = std::min(nread, capacity - offset);
+        std::memcpy(ptr, data + offset, first);
+        std::memcpy(ptr + first, data, nread - first);
+        header->tail.store(tail + nread);
+
+        if (header->writerWaiting.load() && header->writerWaiting.exchange(false))
+            ring(spaceBell[1]);
+        n -= nread;
+        ptr += nread;
+    }
+}
+
+// same framing as Pipe::read(), returns the size of the header
+size_t ShmRing::readHeader(char *header_bytes, BinaryFormat format) {
+    size_t header_size;
+    if (format == BinaryFormat::SIZE_T) {
+        header_size = sizeof(size_t);
+        read(header_bytes, header_size);
+    } else {
+        header_size = 0;
+        do {                                        // varint: one byte at a time up to the last one
+            if (header_size == max_varint_size)
+                throw PipeException("invalid size header");
+            read(header_bytes + header_size, 1);
+        } while (header_bytes[header_size++] & 0x80);
+    }
+    return header_size;
+}
+
+std::shared_ptr<char []> ShmRing::read(BinaryFormat format) {
+    char header_bytes[max_varint_size];
+    size_t header_size = readHeader(header_bytes, format);
+    size_t total_size = BinaryReader::objectSize(header_bytes, format) - header_size;
+
+    std::shared_ptr<char[]> ptr(new char[header_size + total_size]);
+    std::memcpy(ptr.get(), header_bytes, header_size);
+    read(ptr.get() + header_size, total_size);
+
+    readyRead = false;
+    return ptr;
+}
+
+// into a reused buffer, as Pipe::read()
+std::span<const char> ShmRing::read(std::vector<char>& buffer, BinaryFormat format) {
+    char header_bytes[max_varint_size];
+    size_t header_size = readHeader(header_bytes, format);
+    size_t message_size = BinaryReader::objectSize(header_bytes, format);
+
+    if (buffer.size() < message_size)
+        buffer.resize(message_size);
+    std::memcpy(buffer.data(), header_bytes, header_size);
+    read(buffer.data() + header_size, message_size - header_size);
+
+    readyRead = false;
+    return {buffer.data(), message_size};
+}
+
+bool ShmRing::isReadyRead() {
+    return readyRead;
+}
+
+bool ShmRing::isReadyWrite() {
+    return readyWrite;
+}
+
+void ShmRing::close() {
+    closeRead();
+    closeWrite();
+}
+
+void ShmRing::closeRead() {
+    if (readOpen) {
+        ::close(dataBell[0]);
+        ::close(spaceBell[1]);
+        dataBell[0] = spaceBell[1] = INVALID_FD;
+        readOpen = false;
+    }
+    readyRead = false;
+}
+
+void ShmRing::closeWrite() {
+    if (hasPending()) {
+        closePending = true;    // closed by flush()
+        readyWrite = false;
+        return;
+    }
+    if (writeOpen) {
+        ::close(dataBell[1]);
+        ::close(spaceBell[0]);
+        dataBell[1] = spaceBell[0] = INVALID_FD;
+        writeOpen = false;
+    }
+    readyWrite = false;
+}
+
+bool ShmRing::isClose() {
+    return !readOpen && !writeOpen;
+}
+
+// Ready for read: data in the ring or EOF. Ready for write: nothing pending and space in the ring.
+// Blocks on the doorbells only if no ring is ready.
+void ShmRing::select(const std::vector<std::shared_ptr<ShmRing>>& rings) {
+    fd_set rset;
+    int maxfd = -1;
+    bool ready = false;
+
+    auto update_write = [](ShmRing& ring) {
+        if (ring.hasPending())
+            ring.flush();
+        if (ring.writeOpen && !ring.hasPending() && !ring.closePending && ring.space() > 0)
+            ring.readyWrite = true;
+        return ring.readyWrite || !ring.writeOpen;
+    };
+
+    // prepare set, announcing the wait to the other sides
+    FD_ZERO(&rset);
+    for (const auto& ring : rings) {
+        if (ring->dataBell[0] >= FD_SETSIZE || ring->spaceBell[0] >= FD_SETSIZE)
+            throw PipeException("too many file descriptors for select()");
+        if (ring->readOpen) {
+            ring->header->readerWaiting.store(true);
+            if (ring->available() > 0 || ring->eof) {
+                ring->readyRead = ready = true;
+            } else {
+                FD_SET(ring->dataBell[0], &rset);
+                maxfd = std::max(maxfd, ring->dataBell[0]);
+            }
+        }
+        if (ring->writeOpen) {
+            ring->header->writerWaiting.store(true);
+            if (update_write(*ring)) {
+                ready = ready || ring->readyWrite;
+            } else {
+                FD_SET(ring->spaceBell[0], &rset);
+                maxfd = std::max(maxfd, ring->spaceBell[0]);
+            }
+        }
+    }
+
+    // select (just a check of the doorbells if some ring is already ready)
+    struct timeval zero = {0, 0};
+    if (maxfd >= 0) {
+        if (::select(maxfd + 1, &rset, NULL, NULL, ready ? &zero : NULL) < 0) {
+            if (errno != EINTR)
+                throw PipeException("select() failed");
+            FD_ZERO(&rset);
+        }
+        for (const auto& ring : rings) {
+            if (ring->readOpen && FD_ISSET(ring->dataBell[0], &rset)) {
+                if (drain(ring->dataBell[0]))
+                    ring->eof = true;
+                ring->readyRead = ring->available() > 0 || ring->eof;
+            }
+            if (ring->writeOpen && FD_ISSET(ring->spaceBell[0], &rset)) {
+                if (drain(ring->spaceBell[0]))
+                    throw PipeException("write() failed");      // read end closed
+                update_write(*ring);
+            }
+        }
+    }
+
+    for (const auto& ring : rings) {
+        if (ring->readOpen)
+            ring->header->readerWaiting.store(false);
+        if (ring->writeOpen)
+            ring->header->writerWaiting.store(false);
+    }
+}
+
+int ShmRing::readEventFd() const {
+    return dataBell[0];
+}
+
+int ShmRing::writeEventFd() const {
+    return spaceBell[0];
+}
+
+uint32_t ShmRing::writeEventMask() {
+    return EPOLLIN;
+}
+
+// Ready for read: data in the ring or EOF, checked directly, so the edge-triggered doorbell is only needed to sleep.
+// The reader announces the wait before the check, as in waitData(), and withdraws it once it has data, so that the
+// writer rings again only when the reader is going to sleep. Returns whether ready for read.
+bool ShmRing::updateRead(bool event, bool hangup) {
+    if (!readOpen)
+        return false;
+    if ((event || hangup) && drain(dataBell[0]))
+        eof = true;
+
+    if (!readyRead) {
+        header->readerWaiting.store(true);
+        if (available() > 0 || eof)
+            readyRead = true;
+    }
+    if (readyRead)
+        header->readerWaiting.store(false);
+    return readyRead;
+}
+
+// Flushes the pending bytes, announcing the wait for space if some are left, as in waitSpace().
+// Returns whether there are still pending bytes, i.e. whether the space doorbell is needed.
+bool ShmRing::updateWrite(bool event) {
+    if (!writeOpen)
+        return false;
+    if (event && drain(spaceBell[0]))
+        throw PipeException("write() failed");      // read end closed
+
+    while (hasPending()) {
+        flush();
+        if (!hasPending())
+            break;
+        header->writerWaiting.store(true);
+        if (space() == 0)
+            break;
+    }
+    if (!hasPending())
+        header->writerWaiting.store(false);
+
+    readyWrite = writeOpen && !hasPending() && !closePending;
+    return writeOpen && hasPending();
+}
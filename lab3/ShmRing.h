@@ -0,0 +1,77 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include "Serializable.h"
+#include <vector>
+#include <span>
+#include <initializer_list>
+#include <atomic>
+#include <cstdint>
+
+// Single-producer single-consumer byte ring in shared memory (mmap(MAP_SHARED), create before fork), with the
+// interface and the read/write/close/EOF semantics of Pipe, so that the engines can use either one.
+// The payload only goes through the shared memory. Wakeups go through two "doorbell" pipes, that get one byte
+// only when the other side is about to sleep: data (producer -> consumer) and space (consumer -> producer).
+// Being pipes, EOF is when every process has closed the write end, as for Pipe, and select() works on them.
+class ShmRing {
+    struct Header {
+        alignas(64) std::atomic<uint64_t> head;     // bytes written, by the producer
+        alignas(64) std::atomic<uint64_t> tail;     // bytes read, by the consumer
+        alignas(64) std::atomic<bool> readerWaiting;
+        alignas(64) std::atomic<bool> writerWaiting;
+    };
+
+    Header *header;
+    char *data;
+    size_t capacity;                    // power of 2
+    int dataBell[2], spaceBell[2];      // [0] read end, [1] write end
+    bool readOpen, writeOpen;
+    bool readyRead, readyWrite;
+    bool eof;                           // the data doorbell reported EOF
+    bool nonblocking, closePending;
+    std::vector<char> outbox;           // nonblocking mode: bytes accepted by write() but not yet in the ring
+    size_t outboxPosition;
+
+    ShmRing(const ShmRing& other) = delete;
+    ShmRing& operator=(const ShmRing& other) = delete;
+
+    size_t available() const;
+    size_t space() const;
+    size_t put(const char *ptr, size_t n);
+    void read(char *ptr, size_t n);
+    size_t readHeader(char *header, BinaryFormat format);
+    void flush();
+    static void ring(int fd);
+    static bool drain(int fd);
+    void waitData();
+    void waitSpace();
+
+public:
+    ShmRing(size_t capacity = 1 << 20);
+    ~ShmRing();
+    void setNonblocking();
+    void write(const std::vector<char>& content);
+    void write(std::initializer_list<std::span<const char>> segments);
+    void setZeroCopy(size_t threshold);
+    void writeSpliced(std::span<const char> header, std::vector<char>& payload);
+    bool hasPending();
+    std::shared_ptr<char[]> read(BinaryFormat format = BinaryFormat::SIZE_T);
+    std::span<const char> read(std::vector<char>& buffer, BinaryFormat format = BinaryFormat::SIZE_T);
+    bool isReadyRead();
+    bool isReadyWrite();
+    void close();
+    void closeRead();
+    void closeWrite();
+    bool isClose();
+    static void select(const std::vector<std::shared_ptr<ShmRing>>& rings);
+
+    // Poller interface
+    int readEventFd() const;
+    int writeEventFd() const;
+    static uint32_t writeEventMask();
+    bool updateRead(bool event, bool hangup = false);
+    bool updateWrite(bool event);
+};
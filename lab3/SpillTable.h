@@ -0,0 +1,238 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include <queue>
+#include <string>
+#include <memory>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <unistd.h>
+#include "Serializable.h"
+#include "Result.h"
+
+// Accumulators by key with a memory budget. When the (estimated) size of the table exceeds it, the table is written
+// to a temporary file as a run sorted by key and emptied: the next records of a key start again from A().
+// forEach() then merges the runs and the table (k-way, by key), folding the partial accumulators of each key in the
+// order they were built with the merge function. At most max_runs runs are open: then they are merged in one.
+// With budget 0 it is just the std::unordered_map.
+template<typename K, typename A>
+class SpillTable {
+    typedef Result<K,A> EntryT;
+    typedef std::function<void(const K&, A&, const A&)> MergeT;
+    static constexpr std::size_t chunk_size = 1024;         // entries per message in the runs
+    static constexpr std::size_t max_runs = 64;             // then merged in one run
+    static constexpr BinaryFormat format = BinaryFormat::SIZE_T;
+
+    std::unordered_map<K,A> table;
+    std::size_t budget, bytes;
+    std::string directory;
+    MergeT merge;
+    std::vector<std::FILE *> runs;
+
+    SpillTable(const SpillTable& other) = delete;
+    SpillTable& operator=(const SpillTable& other) = delete;
+
+    // heap memory of a key or an accumulator
+    template<typename T>
+    static std::size_t heapSize(const T& x) {
+        if constexpr (std::is_same_v<T, std::string>) {
+            const char *object = reinterpret_cast<const char *>(&x);
+            bool inline_buffer = x.data() >= object && x.data() < object + sizeof(x);     // short string
+            return inline_buffer ? 0 : x.capacity() + 1;
+        } else {
+            return 0;
+        }
+    }
+
+    // node of the hash table, with its bucket
+    static std::size_t entrySize(const K& key) {
+        return sizeof(std::pair<const K,A>) + 2 * sizeof(void *) + heapSize(key);
+    }
+
+    // sequential writer of a new run (unlinked temporary file), one chunk in memory
+    class RunWriter {
+        std::FILE *run;
+        std::vector<EntryT> chunk;
+
+        void writeChunk() {
+            std::vector<char> v = serialize_binary(chunk, format);
+            if (std::fwrite(v.data(), 1, v.size(), run) != v.size())
+                throw std::runtime_error("error - fwrite() failed");
+            chunk.clear();
+        }
+
+    public:
+        explicit RunWriter(const std::string& directory) {
+            std::string path = directory + "/spill-XXXXXX";
+            int fd = ::mkstemp(path.data());
+            if (fd < 0)
+                throw std::runtime_error("error - mkstemp() failed");
+            ::unlink(path.c_str());     // removed when closed
+            run = ::fdopen(fd, "w+");
+            if (run == nullptr)
+                throw std::runtime_error("error - fdopen() failed");
+        }
+
+        void write(const K& key, A&& acc) {
+            chunk.emplace_back(key, std::move(acc));
+            if (chunk.size() == chunk_size)
+                writeChunk();
+        }
+
+        std::FILE *finish() {
+            if (!chunk.empty())
+                writeChunk();
+            if (std::fflush(run) != 0)
+                throw std::runtime_error("error - fflush() failed");
+            return run;
+        }
+    };
+
+    // sequential reader of a run, one chunk in memory
+    class RunReader {
+        std::FILE *run;
+        std::vector<EntryT> chunk;
+        std::size_t position;
+
+    public:
+        explicit RunReader(std::FILE *run): run(run), position(0) {
+            std::rewind(run);
+            next();
+        }
+
+        bool atEnd() const { return position == chunk.size(); }
+        const EntryT& current() const { return chunk[position]; }
+
+        void next() {
+            if (++position < chunk.size())
+                return;
+            chunk.clear();
+            position = 0;
+
+            std::size_t header;
+            if (std::fread(&header, sizeof(header), 1, run) != 1)
+                return;     // end of the run
+            std::size_t total_size = BinaryReader::objectSize(reinterpret_cast<const char *>(&header), format);
+            std::shared_ptr<char[]> ptr(new char[total_size]);
+            std::memcpy(ptr.get(), &header, sizeof(header));
+            if (std::fread(ptr.get() + sizeof(header), 1, total_size - sizeof(header), run) !=
+                    total_size - sizeof(header))
+                throw std::runtime_error("error - truncated spill run");
+            chunk = deserialize_binary<EntryT>(ptr, format);
+        }
+    };
+
+    // the table, sorted by key, to a new run
+    void spill() {
+        std::vector<typename std::unordered_map<K,A>::iterator> sorted;
+        sorted.reserve(table.size());
+        for (auto it = table.begin(); it != table.end(); ++it)
+            sorted.push_back(it);
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a->first < b->first; });
+
+        RunWriter writer(directory);
+        for (auto& it : sorted)
+            writer.write(it->first, std::move(it->second));
+        runs.push_back(writer.finish());
+
+        sorted.clear();
+        std::unordered_map<K,A>().swap(table);      // give back the buckets too
+        bytes = 0;
+
+        if (runs.size() == max_runs) {
+            RunWriter merged(directory);
+            mergeRuns([&merged](const K& key, A&& acc) { merged.write(key, std::move(acc)); });
+            runs.push_back(merged.finish());
+        }
+    }
+
+    // k-way merge of the runs, calling fun(const K&, A&&) once for each key in key order, then closes them
+    template<typename F>
+    void mergeRuns(F fun) {
+        std::vector<RunReader> readers;
+        readers.reserve(runs.size());
+        for (std::FILE *run : runs)
+            readers.emplace_back(run);
+
+        // min-heap by key, then by run (the order the partial accumulators were built)
+        auto greater = [&readers](std::size_t a, std::size_t b) {
+            const K& key_a = readers[a].current().getKey();
+            const K& key_b = readers[b].current().getKey();
+            return key_b < key_a || (!(key_a < key_b) && b < a);
+        };
+        std::priority_queue<std::size_t, std::vector<std::size_t>, decltype(greater)> heap(greater);
+        for (std::size_t i=0; i<readers.size(); i++)
+            if (!readers[i].atEnd())
+                heap.push(i);
+
+        while (!heap.empty()) {
+            std::size_t i = heap.top();
+            heap.pop();
+            K key = readers[i].current().getKey();
+            A acc = readers[i].current().getValue();
+            readers[i].next();
+            if (!readers[i].atEnd())
+                heap.push(i);
+
+            while (!heap.empty() && !(key < readers[heap.top()].current().getKey())) {
+                std::size_t j = heap.top();
+                heap.pop();
+                merge(key, acc, readers[j].current().getValue());
+                readers[j].next();
+                if (!readers[j].atEnd())
+                    heap.push(j);
+            }
+            fun(key, std::move(acc));
+        }
+
+        for (std::FILE *run : runs)
+            std::fclose(run);
+        runs.clear();
+    }
+
+public:
+    // merge(const K&, A& acc, const A& partial) folds a later partial accumulator of a key into acc
+    explicit SpillTable(std::size_t budget = 0, std::string directory = "/tmp", MergeT merge = nullptr):
+            budget(budget), bytes(0), directory(std::move(directory)), merge(std::move(merge)) {}
+
+    ~SpillTable() {
+        for (std::FILE *run : runs)
+            std::fclose(run);
+    }
+
+    // updates the accumulator of key with fun(A&), spilling if over budget
+    template<typename F>
+    void update(const K& key, F fun) {
+        auto [it, inserted] = table.try_emplace(key);
+        std::size_t before = inserted ? 0 : heapSize(it->second);
+        fun(it->second);
+        if (budget == 0)
+            return;
+
+        bytes += heapSize(it->second) - before + (inserted ? entrySize(key) : 0);
+        if (bytes > budget)
+            spill();
+    }
+
+    // Calls fun(const K&, A&&) once for each key, in key order if spilled. The table is left empty.
+    template<typename F>
+    void forEach(F fun) {
+        if (runs.empty()) {
+            for (auto& entry : table)
+                fun(entry.first, std::move(entry.second));
+            table.clear();
+            return;
+        }
+        spill();    // the table is the last run
+        mergeRuns(fun);
+    }
+};
@@ -0,0 +1,752 @@
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <charconv>
+#include <map>
+#include <thread>
+#include <sys/resource.h>
+#include "Serializable.h"
+#include "MapperInput.h"
+#include "Result.h"
+#include "ReducerInput.h"
+#include "MapReduce.h"
+#include "LogRecord.h"
+#include "LegacyBinary.h"
+
+// time of fun() in milliseconds
+template<typename F>
+double measure_ms(F fun) {
+    auto start = std::chrono::steady_clock::now();
+    fun();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+template<typename T>
+void compare_binary(const std::vector<T>& objs, const std::string& name) {
+    std::vector<char> legacy, current;
+    double legacy_encode = measure_ms([&]() { legacy = legacy_serialize(objs); });
+    double current_encode = measure_ms([&]() { current = serialize_binary(objs); });
+    std::size_t checksum = 0;
+    double legacy_decode = measure_ms([&]() { checksum += legacy_deserialize<T>(legacy.data()).size(); });
+    double current_decode = measure_ms([&]() {
+        BinaryReader reader(current.data(), current.size());
+        checksum += deserialize_binary<T>(reader).size();
+    });
+    if (legacy != current)
+        std::cerr << "binary formats differ for " << name << std::endl;
+
+    std::cout << name << " (" << objs.size() << " records, ms):\n";
+    std::cout << "\tencode\tdecode\n";
+    std::cout << "legacy\t" << legacy_encode << "\t" << legacy_decode << "\n";
+    std::cout << "writer\t" << current_encode << "\t" << current_decode << "\n";
+}
+
+/****************************************
+ * Binary formats: size, encode, decode *
+ ****************************************/
+const std::vector<std::pair<BinaryFormat, std::string>> formats = {
+        {BinaryFormat::SIZE_T, "size_t"},
+        {BinaryFormat::VARINT, "varint"},
+        {BinaryFormat::VARINT_FIXED, "varint+fixed"}
+};
+
+template<typename T>
+void compare_formats(const std::vector<T>& objs, const std::string& name) {
+    std::cout << name << " (" << objs.size() << " records):\n";
+    std::cout << "format\tbytes/record\tencode rec/s\tdecode rec/s\n";
+    for (const auto& [format, format_name] : formats) {
+        std::vector<char> serialized;
+        std::vector<T> deserialized;
+        double encode = measure_ms([&]() { serialized = serialize_binary(objs, format); });
+        double decode = measure_ms([&]() {
+            BinaryReader reader(serialized.data(), serialized.size(), format);
+            deserialized = deserialize_binary<T>(reader);
+        });
+        if (deserialized.size() != objs.size())
+            std::cerr << "wrong number of records decoded for " << name << std::endl;
+
+        std::cout << format_name << "\t" << static_cast<double>(serialized.size()) / objs.size() << "\t"
+                  << objs.size() / encode * 1000 << "\t" << objs.size() / decode * 1000 << "\n";
+    }
+}
+
+/***************************************
+ * Vectors of packed objects: bulk copy *
+ ***************************************/
+void compare_bulk(std::size_t n_records) {
+    typedef Result<int,int> ResultT;
+    std::vector<ResultT> objs, objs_per_object, objs_bulk;
+    for (std::size_t i=0; i<n_records; i++)
+        objs.emplace_back(i, i % 100);
+
+    // object by object, as for the other types
+    BinaryWriter writer;
+    double per_object_encode = measure_ms([&]() {
+        std::size_t object = writer.beginObject();
+        for (const auto& obj : objs)
+            obj.serializeBinary(writer);
+        writer.endObject(object);
+    });
+    double per_object_decode = measure_ms([&]() {
+        BinaryReader reader(writer.data(), writer.size());
+        std::size_t end = reader.readSize();
+        end += reader.getPosition();
+        while (reader.getPosition() < end) {
+            objs_per_object.emplace_back();
+            objs_per_object.back().deserializeBinary(reader);
+        }
+    });
+
+    // in bulk, as in BinaryFormat::VARINT_FIXED
+    std::vector<char> serialized;
+    double bulk_encode = measure_ms([&]() { serialized = serialize_binary(objs, BinaryFormat::VARINT_FIXED); });
+    double bulk_decode = measure_ms([&]() {
+        BinaryReader reader(serialized.data(), serialized.size(), BinaryFormat::VARINT_FIXED);
+        objs_bulk = deserialize_binary<ResultT>(reader);
+    });
+    if (objs_per_object.size() != n_records || objs_bulk.size() != n_records ||
+        objs_bulk.back().getKey() != objs.back().getKey())
+        std::cerr << "wrong records decoded for Result<int,int>" << std::endl;
+
+    std::cout << "Result<int,int> vector (" << n_records << " records):\n";
+    std::cout << "\tbytes/record\tencode rec/s\tdecode rec/s\tencode MB/s\tdecode MB/s\n";
+    std::cout << "object\t" << static_cast<double>(writer.size()) / n_records << "\t"
+              << n_records / per_object_encode * 1000 << "\t" << n_records / per_object_decode * 1000 << "\t"
+              << writer.size() / per_object_encode / 1000 << "\t" << writer.size() / per_object_decode / 1000 << "\n";
+    std::cout << "bulk\t" << static_cast<double>(serialized.size()) / n_records << "\t"
+              << n_records / bulk_encode * 1000 << "\t" << n_records / bulk_decode * 1000 << "\t"
+              << serialized.size() / bulk_encode / 1000 << "\t" << serialized.size() / bulk_decode / 1000 << "\n";
+}
+
+/********************************
+ * JSON: ptree against streaming *
+ ********************************/
+// null-terminated copy, as expected by deserialize_json
+std::shared_ptr<char[]> to_shared(const std::vector<char>& v) {
+    std::shared_ptr<char[]> p(new char[v.size() + 1]);
+    std::memcpy(p.get(), v.data(), v.size());
+    p[v.size()] = 0;
+    return p;
+}
+
+template<typename T>
+void compare_json(const std::vector<T>& objs, const std::string& name) {
+    std::vector<char> ptree, streaming;
+    std::vector<T> ptree_objs, streaming_objs;
+    double streaming_encode = measure_ms([&]() { streaming = serialize_json(objs); });
+    double ptree_encode = measure_ms([&]() { ptree = serialize_json_ptree(objs); });
+    std::shared_ptr<char[]> serialized = to_shared(streaming);
+    std::string ptree_error;
+    double ptree_decode = measure_ms([&]() {
+        try {
+            ptree_objs = deserialize_json_ptree<T>(serialized);
+        } catch (const pt::ptree_error& e) {
+            ptree_error = e.what();     // e.g. log lines that are not valid UTF-8
+        }
+    });
+    double streaming_decode = measure_ms([&]() { streaming_objs = deserialize_json<T>(serialized); });
+    if (ptree != streaming)
+        std::cerr << "JSON outputs differ for " << name << std::endl;
+    if ((ptree_error.empty() && ptree_objs.size() != objs.size()) || streaming_objs.size() != objs.size())
+        std::cerr << "wrong number of records decoded for " << name << std::endl;
+
+    std::cout << name << " JSON (" << objs.size() << " records, " << static_cast<double>(streaming.size()) / objs.size()
+              << " bytes/record, ms):\n";
+    std::cout << "\tencode\tdecode\n";
+    std::cout << "ptree\t" << ptree_encode << "\t";
+    if (ptree_error.empty())
+        std::cout << ptree_decode << "\n";
+    else
+        std::cout << "failed (" << ptree_error << ")\n";
+    std::cout << "stream\t" << streaming_encode << "\t" << streaming_decode << "\n";
+}
+
+/*********************************
+ * Messages through a pipe (IPC) *
+ *********************************/
+// batch_size objects per message to a child process, that deserializes them: one allocated message per write and per
+// read (serialize_binary(), Pipe::read(format)) against the reused buffers and the gathered writes (write_binary(),
+// read_binary())
+template<typename T>
+void compare_pipe_messages(const std::vector<T>& objs, const std::string& name) {
+    std::cout << name << " through a pipe (" << objs.size() << " records, records/s):\n";
+    std::cout << "batch\tallocated\tpooled\n";
+    for (std::size_t batch_size : {1, 16, 256}) {
+        std::cout << batch_size;
+        for (bool pooled : {false, true}) {
+            std::cout.flush();
+            double ms = measure_ms([&]() {
+                Pipe pipe;
+                pid_t pid = fork();
+                if (!pid) {
+                    pipe.closeWrite();
+                    std::vector<char> buffer;
+                    std::size_t n = 0;
+                    try {
+                        while (true)
+                            n += pooled ? read_binary<T>(pipe, buffer, BinaryFormat::VARINT).size() :
+                                 deserialize_binary<T>(pipe.read(BinaryFormat::VARINT), BinaryFormat::VARINT).size();
+                    } catch (const PipeException& e) {
+                        std::exit(n == objs.size() ? EXIT_SUCCESS : EXIT_FAILURE);
+                    }
+                }
+                pipe.closeRead();
+                BinaryWriter writer(BinaryFormat::VARINT);
+                std::span<const T> all(objs);
+                for (std::size_t i=0; i<objs.size(); i+=batch_size) {
+                    std::span<const T> batch = all.subspan(i, std::min(batch_size, objs.size() - i));
+                    if (pooled)
+                        write_binary(pipe, batch, writer);
+                    else
+                        pipe.write(serialize_binary(batch, BinaryFormat::VARINT));
+                }
+                pipe.closeWrite();
+                int status;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                    std::cerr << "records lost through the pipe" << std::endl;
+            });
+            std::cout << "\t" << objs.size() / ms * 1000;
+        }
+        std::cout << "\n";
+    }
+}
+
+// One big record per message (as a concatenated list of IP addresses), copied with write() against spliced with
+// vmsplice() (Pipe::setZeroCopy()), by payload size: where splicing starts to pay off. The messages cycle through
+// n_distinct contents (key and every byte of the value) and the reader checks every byte, so that a spliced payload
+// overwritten by one of the next messages before being read shows up.
+void compare_zero_copy() {
+    const std::size_t total_bytes = 256 << 20, n_distinct = 16;
+    std::cout << "one Result<string,string> per message through a pipe (" << (total_bytes >> 20) << " MiB, MiB/s):\n";
+    std::cout << "payload\twrite\tvmsplice\n";
+    for (std::size_t payload_size = 256; payload_size <= (4 << 20); payload_size *= 4) {
+        std::vector<std::vector<Result<std::string,std::string>>> messages;
+        for (std::size_t j=0; j<n_distinct; j++)
+            messages.push_back({{std::to_string(j), std::string(payload_size, static_cast<char>('a' + j))}});
+        std::size_t n_messages = total_bytes / payload_size;
+        std::cout << payload_size;
+        for (bool zero_copy : {false, true}) {
+            std::cout.flush();
+            double ms = measure_ms([&]() {
+                Pipe pipe;
+                pipe.setZeroCopy(zero_copy ? 1 : 0);
+                pid_t pid = fork();
+                if (!pid) {
+                    pipe.closeWrite();
+                    std::vector<char> buffer;
+                    std::size_t n = 0;
+                    try {
+                        while (true) {
+                            const auto& expected = messages[n % n_distinct].front();
+                            auto r = read_binary<Result<std::string,std::string>>(pipe, buffer, BinaryFormat::VARINT);
+                            if (r.size() != 1 || r.front().getKey() != expected.getKey() ||
+                                    r.front().getValue() != expected.getValue())
+                                std::exit(EXIT_FAILURE);
+                            n++;
+                        }
+                    } catch (const PipeException& e) {
+                        std::exit(n == n_messages ? EXIT_SUCCESS : EXIT_FAILURE);
+                    }
+                }
+                pipe.closeRead();
+                BinaryWriter writer(BinaryFormat::VARINT);
+                for (std::size_t i=0; i<n_messages; i++)
+                    write_binary(pipe, messages[i % n_distinct], writer);
+                pipe.closeWrite();
+                int status;
+                waitpid(pid, &status, 0);
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+                    std::cerr << "records lost or corrupted through the pipe" << std::endl;
+            });
+            std::cout << "\t" << (total_bytes >> 20) / ms * 1000;
+        }
+        std::cout << "\n";
+    }
+}
+
+/**************************************
+ * Map-reduce: count by IP on the log *
+ **************************************/
+typedef Result<std::string,int> CountT;
+
+auto map_count_by_ip = [](const MapperInput& mapper_input) {
+    const std::string& line = mapper_input.getInput();
+    return std::vector{CountT(line.substr(0, line.find(' ')), 1)};
+};
+
+auto reduce_count = [](const ReducerInput<std::string,int,int>& input) {
+    return CountT(input.getKey(), input.getAcc() + input.getValue());
+};
+
+// results sorted by key, to compare engines
+std::map<std::string,int> count_by_ip(std::istream& input, const MapReduceOptions& options, double& ms,
+                                      bool combine = false) {
+    std::vector<CountT> results;
+    input.clear();
+    input.seekg(0);
+    std::cout.flush();      // the workers exit with std::exit(), that flushes the inherited buffer
+    ms = measure_ms([&]() {
+        if (combine)
+            results = map_reduce_multi_process_multiplexed
+                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                    (input, map_count_by_ip, reduce_count, reduce_count, options);
+        else
+            results = map_reduce_multi_process_multiplexed
+                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                    (input, map_count_by_ip, reduce_count, options);
+    });
+    std::map<std::string,int> sorted;
+    for (const auto& r : results)
+        sorted[r.getKey()] = r.getValue();
+    return sorted;
+}
+
+std::map<std::string,int> count_by_ip_reference(std::istream& input) {
+    input.clear();
+    input.seekg(0);
+    auto results = map_reduce_single_process
+            <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+            (input, map_count_by_ip, reduce_count);
+    std::map<std::string,int> sorted;
+    for (const auto& r : results)
+        sorted[r.getKey()] = r.getValue();
+    return sorted;
+}
+
+void compare_map_reduce(std::istream& input, std::size_t n_lines) {
+    double ms;
+    std::cout << "count by IP, multiplexed (" << n_lines << " lines):\n";
+    std::cout << "format\tlines/s\n";
+    for (const auto& [format, format_name] : formats) {
+        MapReduceOptions options;
+        options.format = format;
+        count_by_ip(input, options, ms);
+        std::cout << format_name << "\t" << n_lines / ms * 1000 << "\n";
+    }
+}
+
+// n mappers and n reducers
+void scaling_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, multiplexed, scaling (" << n_lines << " lines, "
+              << std::thread::hardware_concurrency() << " cores):\n";
+    std::cout << "mappers\treducers\tlines/s\n";
+    for (unsigned int n : {1, 2, 4, 8, 16}) {
+        MapReduceOptions options;
+        options.format = BinaryFormat::VARINT;
+        options.n_mappers = options.n_reducers = n;
+        if (count_by_ip(input, options, ms) != reference)
+            std::cerr << "wrong results with " << n << " mappers/reducers" << std::endl;
+        std::cout << n << "\t" << n << "\t" << n_lines / ms * 1000 << "\n";
+    }
+}
+
+// records per message, with 1 and 4 mappers/reducers
+void batching_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, multiplexed, batching (" << n_lines << " lines):\n";
+    std::cout << "batch\t1+1 lines/s\t4+4 lines/s\n";
+    for (unsigned int batch_size = 1; batch_size <= 4096; batch_size *= 4) {
+        std::cout << batch_size;
+        for (unsigned int n : {1, 4}) {
+            MapReduceOptions options;
+            options.format = BinaryFormat::VARINT;
+            options.n_mappers = options.n_reducers = n;
+            options.batch_size = batch_size;
+            if (count_by_ip(input, options, ms) != reference)
+                std::cerr << "wrong results with batch size " << batch_size << std::endl;
+            std::cout << "\t" << n_lines / ms * 1000;
+        }
+        std::cout << "\n";
+    }
+}
+
+// Pipe against ShmRing, with 1 and 4 mappers/reducers
+void transport_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, multiplexed, transport (" << n_lines << " lines, lines/s):\n";
+    std::cout << "batch\tpipe 1+1\tshm 1+1\tpipe 4+4\tshm 4+4\n";
+    for (unsigned int batch_size : {1, 16, 256, 4096}) {
+        std::cout << batch_size;
+        for (unsigned int n : {1, 4}) {
+            for (Transport transport : {Transport::PIPE, Transport::SHARED_MEMORY}) {
+                MapReduceOptions options;
+                options.format = BinaryFormat::VARINT;
+                options.transport = transport;
+                options.n_mappers = options.n_reducers = n;
+                options.batch_size = batch_size;
+                if (count_by_ip(input, options, ms) != reference)
+                    std::cerr << "wrong results with batch size " << batch_size << std::endl;
+                std::cout << "\t" << n_lines / ms * 1000;
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+// without and with combiner (reduce_count), with 1 and 4 mappers/reducers, returns whether all results were right
+bool combiner_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    bool ok = true;
+    double ms;
+    std::cout << "count by IP, multiplexed, combiner (" << n_lines << " lines, lines/s):\n";
+    std::cout << "batch\t1+1\t1+1 combiner\t4+4\t4+4 combiner\n";
+    for (unsigned int batch_size : {1, 256}) {
+        std::cout << batch_size;
+        for (unsigned int n : {1, 4}) {
+            for (bool combine : {false, true}) {
+                MapReduceOptions options;
+                options.format = BinaryFormat::VARINT;
+                options.n_mappers = options.n_reducers = n;
+                options.batch_size = batch_size;
+                if (count_by_ip(input, options, ms, combine) != reference) {
+                    std::cerr << "wrong results with batch size " << batch_size << std::endl;
+                    ok = false;
+                }
+                std::cout << "\t" << n_lines / ms * 1000;
+            }
+        }
+        std::cout << "\n";
+    }
+    return ok;
+}
+
+// reducers replying to every message against stateful reducers, on both engines
+void reducers_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, stateful reducers (" << n_lines << " lines, lines/s):\n";
+    std::cout << "reducers\tsynchronous\tmultiplexed 1+1\tmultiplexed 4+4\n";
+    for (bool stateful : {false, true}) {
+        MapReduceOptions options;
+        options.format = BinaryFormat::VARINT;
+        options.stateful_reducers = stateful;
+        options.batch_size = 256;
+        std::cout << (stateful ? "stateful" : "round trip");
+
+        std::vector<CountT> results;
+        input.clear();
+        input.seekg(0);
+        std::cout.flush();
+        ms = measure_ms([&]() {
+            results = map_reduce_multi_process_synchronous
+                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                    (input, map_count_by_ip, reduce_count, options);
+        });
+        std::map<std::string,int> sorted;
+        for (const auto& r : results)
+            sorted[r.getKey()] = r.getValue();
+        if (sorted != reference)
+            std::cerr << "wrong results with the synchronous engine" << std::endl;
+        std::cout << "\t" << n_lines / ms * 1000;
+
+        for (unsigned int n : {1, 4}) {
+            options.n_mappers = options.n_reducers = n;
+            if (count_by_ip(input, options, ms) != reference)
+                std::cerr << "wrong results with " << n << " mappers/reducers" << std::endl;
+            std::cout << "\t" << n_lines / ms * 1000;
+        }
+        std::cout << "\n";
+    }
+}
+
+// lines sent by the coordinator against splits of the mapped file, with 1 and 4 mappers/reducers
+void split_map_reduce(std::istream& input, const MappedFile& file, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, multiplexed, mapped file splits (" << n_lines << " lines, lines/s):\n";
+    std::cout << "input\t1+1\t1+1 combiner\t4+4\t4+4 combiner\n";
+    for (bool splits : {false, true}) {
+        std::cout << (splits ? "splits" : "lines");
+        for (unsigned int n : {1, 4}) {
+            for (bool combine : {false, true}) {
+                MapReduceOptions options;
+                options.format = BinaryFormat::VARINT;
+                options.n_mappers = options.n_reducers = n;
+                options.batch_size = 256;
+                std::map<std::string,int> results;
+                if (splits) {
+                    std::vector<CountT> v;
+                    std::cout.flush();
+                    ms = measure_ms([&]() {
+                        if (combine)
+                            v = map_reduce_multi_process_multiplexed
+                                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                                    (file, map_count_by_ip, reduce_count, reduce_count, options);
+                        else
+                            v = map_reduce_multi_process_multiplexed
+                                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                                    (file, map_count_by_ip, reduce_count, options);
+                    });
+                    for (const auto& r : v)
+                        results[r.getKey()] = r.getValue();
+                } else {
+                    results = count_by_ip(input, options, ms, combine);
+                }
+                if (results != reference)
+                    std::cerr << "wrong results with " << n << " mappers/reducers" << std::endl;
+                std::cout << "\t" << n_lines / ms * 1000;
+            }
+        }
+        std::cout << "\n";
+    }
+}
+
+// count by key on n_lines lines with n_keys distinct keys, in memory against spilling with a budget per reducer:
+// time and peak RSS of the workers (spilling first, the peak is over all the workers so far)
+void spill_map_reduce(std::size_t n_lines, std::size_t n_keys, std::size_t budget) {
+    std::string path = "/tmp/spill_benchmark.txt";
+    {
+        std::ofstream out(path);
+        for (std::size_t i=0; i<n_lines; i++)
+            out << "/some/long/path/to/a/resource/number/" << (i * 7919) % n_keys << " GET\n";
+    }
+    MappedFile file(path);
+    std::map<std::string,int> reference;
+    double ms;
+    std::cout << "count by key, spilling (" << n_lines << " lines, " << n_keys << " keys, budget "
+              << budget / 1024 << " KiB):\n";
+    std::cout << "reducers\tms\tworkers peak RSS MiB\n";
+    for (std::size_t spill_budget : {budget, std::size_t(0)}) {
+        MapReduceOptions options;
+        options.format = BinaryFormat::VARINT;
+        options.batch_size = 256;
+        options.stateful_reducers = true;
+        options.spill_budget = spill_budget;
+        std::vector<CountT> results;
+        std::cout.flush();
+        ms = measure_ms([&]() {
+            results = map_reduce_multi_process_multiplexed
+                    <MapperInput, ReducerInput<std::string, int, int>, CountT, std::string, int>
+                    (file, map_count_by_ip, reduce_count, options);
+        });
+        struct rusage usage;
+        getrusage(RUSAGE_CHILDREN, &usage);
+
+        std::map<std::string,int> sorted;
+        for (const auto& r : results)
+            sorted[r.getKey()] = r.getValue();
+        if (reference.empty())
+            reference = std::move(sorted);
+        else if (sorted != reference)
+            std::cerr << "wrong results with spilling" << std::endl;
+        std::cout << (spill_budget > 0 ? "spilling" : "in memory") << "\t" << ms << "\t"
+                  << usage.ru_maxrss / 1024 << "\n";
+    }
+    std::remove(path.c_str());
+}
+
+// counts by IP, by request and by status code: separate passes against one shared scan, with 1 and 4 workers
+auto map_count_by_request = [](const MapperInput& mapper_input) {
+    const std::string& line = mapper_input.getInput();
+    std::size_t start = line.find('"');
+    std::size_t end = line.find('"', start + 1);
+    return std::vector{CountT(line.substr(start + 1, end - start - 1), 1)};
+};
+
+auto map_count_by_status = [](const MapperInput& mapper_input) {
+    const std::string& line = mapper_input.getInput();
+    std::size_t start = line.rfind('"') + 2;
+    return std::vector{CountT(line.substr(start, 3), 1)};
+};
+
+void shared_scan_map_reduce(const MappedFile& file, std::size_t n_lines) {
+    auto by_ip = make_query<ReducerInput<std::string, int, int>, CountT, std::string, int>
+            (map_count_by_ip, reduce_count);
+    auto by_request = make_query<ReducerInput<std::string, int, int>, CountT, std::string, int>
+            (map_count_by_request, reduce_count);
+    auto by_status = make_query<ReducerInput<std::string, int, int>, CountT, std::string, int>
+            (map_count_by_status, reduce_count);
+    std::cout << "3 counts, shared scan (" << n_lines << " lines, ms):\n";
+    std::cout << "workers\t1 query\t3 passes\t1 pass\n";
+    for (unsigned int n : {1, 4}) {
+        MapReduceOptions options;
+        options.format = BinaryFormat::VARINT;
+        options.n_mappers = n;
+        std::size_t n_rejected;
+        std::cout.flush();
+        double one = measure_ms([&]() { map_reduce_shared_scan<MapperInput>(file, options, n_rejected, by_ip); });
+        double separate = measure_ms([&]() {
+            auto [ip] = map_reduce_shared_scan<MapperInput>(file, options, n_rejected, by_ip);
+            auto [request] = map_reduce_shared_scan<MapperInput>(file, options, n_rejected, by_request);
+            auto [status] = map_reduce_shared_scan<MapperInput>(file, options, n_rejected, by_status);
+        });
+        double shared = measure_ms([&]() {
+            auto [ip, request, status] = map_reduce_shared_scan<MapperInput>(file, options, n_rejected,
+                                                                             by_ip, by_request, by_status);
+        });
+        std::cout << n << "\t" << one << "\t" << separate << "\t" << shared << "\n";
+    }
+}
+
+// CPU time of this process (the coordinator), without the workers
+double cpu_ms() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+// select() against epoll, with n mappers and n reducers: throughput and coordinator CPU time
+void multiplexer_map_reduce(std::istream& input, std::size_t n_lines) {
+    std::map<std::string,int> reference = count_by_ip_reference(input);
+    double ms;
+    std::cout << "count by IP, multiplexed, select against epoll (" << n_lines << " lines, pipes):\n";
+    std::cout << "workers\tmultiplexer\tlines/s\tcoordinator CPU ms\n";
+    for (unsigned int n : {1, 16, 64, 128}) {
+        for (Multiplexer multiplexer : {Multiplexer::SELECT, Multiplexer::EPOLL}) {
+            MapReduceOptions options;
+            options.format = BinaryFormat::VARINT;
+            options.multiplexer = multiplexer;
+            options.n_mappers = options.n_reducers = n;
+            options.batch_size = 256;
+            std::cout << n << "+" << n << "\t" << (multiplexer == Multiplexer::SELECT ? "select" : "epoll") << "\t";
+            double cpu_start = cpu_ms();
+            try {
+                if (count_by_ip(input, options, ms) != reference)
+                    std::cerr << "wrong results with " << n << " mappers/reducers" << std::endl;
+            } catch (const PipeException& e) {
+                std::cout << "failed (" << e.what() << ")\n";
+                continue;
+            }
+            std::cout << n_lines / ms * 1000 << "\t" << cpu_ms() - cpu_start << "\n";
+        }
+    }
+}
+
+// extraction of ip, hour, url and status from the lines: istringstream (as the mappers did) against LogRecord
+void compare_parsing(const std::vector<MapperInput>& lines) {
+    std::size_t iss_sum = 0, record_sum = 0;     // sums of hours and status codes, to compare the parsers
+    double iss_ms = measure_ms([&]() {
+        for (const auto& line : lines) {
+            std::istringstream iss(line.getInput());
+            std::string ip, url;
+            int hour, status;
+            iss >> ip;
+            iss.ignore(std::numeric_limits<std::streamsize>::max(), ':');
+            iss >> hour;
+            iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
+            iss.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
+            iss >> url;
+            std::istringstream status_iss(line.getInput());     // the url can be the status, in malformed requests
+            status_iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
+            do {
+                status_iss.clear();
+                status_iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
+                status_iss >> status;
+            } while (status_iss.fail());   // there can be " in the URL
+            iss_sum += hour + status;
+        }
+    });
+    double record_ms = measure_ms([&]() {
+        for (const auto& line : lines) {
+            std::optional<LogRecord> record = LogRecord::parse(line.getInput());
+            int hour = 0, status = 0;
+            if (record) {
+                std::from_chars(record->hour.data(), record->hour.data() + record->hour.size(), hour);
+                std::from_chars(record->status.data(), record->status.data() + record->status.size(), status);
+            }
+            record_sum += hour + status;
+        }
+    });
+    if (iss_sum != record_sum)
+        std::cerr << "parsers differ" << std::endl;
+
+    std::cout << "log line parsing (" << lines.size() << " lines, ip + hour + url + status):\n";
+    std::cout << "parser\tms\tlines/s\n";
+    std::cout << "istringstream\t" << iss_ms << "\t" << lines.size() / iss_ms * 1000 << "\n";
+    std::cout << "LogRecord\t" << record_ms << "\t" << lines.size() / record_ms * 1000 << "\n";
+}
+
+int main() {
+    std::ifstream input("localhost_access_log.2020.txt");
+    if (!input.is_open()) {
+        std::cerr << "File not found" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+
+    // records: the log lines, repeated up to n_records
+    const std::size_t n_records = 1000000;
+    std::vector<MapperInput> lines;
+    MapperInput mapper_input;
+    while (input >> mapper_input)
+        lines.push_back(mapper_input);
+    std::vector<MapperInput> mapper_inputs;
+    std::vector<Result<std::string,int>> results;
+    for (std::size_t i=0; i<n_records; i++) {
+        const MapperInput& line = lines[i % lines.size()];
+        mapper_inputs.push_back(line);
+        results.emplace_back(line.getInput().substr(0, line.getInput().find(' ')), 1);
+    }
+
+    compare_binary(mapper_inputs, "MapperInput");
+    compare_binary(results, "Result<string,int>");
+    std::cout << "\n";
+
+    std::vector<ReducerInput<std::string,int,int>> reducer_inputs;
+    for (const auto& result : results)
+        reducer_inputs.emplace_back(result.getKey(), result.getValue(), 42);
+    compare_formats(mapper_inputs, "MapperInput");
+    compare_formats(results, "Result<string,int>");
+    compare_formats(reducer_inputs, "ReducerInput<string,int,int>");
+    std::cout << "\n";
+
+    compare_bulk(10000000);
+    std::cout << "\n";
+
+    compare_json(mapper_inputs, "MapperInput");
+    compare_json(results, "Result<string,int>");
+    std::cout << "\n";
+
+    compare_parsing(mapper_inputs);
+    std::cout << "\n";
+
+    compare_pipe_messages(mapper_inputs, "MapperInput");
+    compare_pipe_messages(results, "Result<string,int>");
+    std::cout << "\n";
+
+    compare_zero_copy();
+    std::cout << "\n";
+
+    compare_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    scaling_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    batching_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    transport_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    multiplexer_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    bool ok = combiner_map_reduce(input, lines.size());
+    std::cout << "\n";
+    if (!ok)
+        return EXIT_FAILURE;
+
+    reducers_map_reduce(input, lines.size());
+    std::cout << "\n";
+
+    MappedFile file("localhost_access_log.2020.txt");
+    split_map_reduce(input, file, lines.size());
+    std::cout << "\n";
+
+    shared_scan_map_reduce(file, lines.size());
+    std::cout << "\n";
+
+    spill_map_reduce(2000000, 1000000, 16 << 20);
+
+    return 0;
+}
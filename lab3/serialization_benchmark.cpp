@@ -0,0 +1,207 @@
+//
+// Created by fruggeri on 10/19/26.
+//
+
+// Encode and decode throughput and size of every serialization format, for the types sent on the pipes, from 1 record
+// up to max_records (10M by default) by powers of 10. Usage: lab3_serialization_benchmark [max_records [repetitions]]
+// Each measure is a warmup run, then repetitions runs (5 by default), more for the small sizes up to min_total_ms of
+// runs. The objects returned by a run (serialized bytes, decoded records) are destroyed after the clock is stopped.
+// The throughput is reported at percentiles of the run times: p90 is the throughput reached by 90% of the runs.
+// The largest size needs about 5 GB of memory (ReducerInput): pass a smaller max_records on smaller machines.
+// Besides the current codecs, the baselines: JSON through a ptree (up to max_ptree_records, a ptree node per field
+// is slow and big; its decoding fails on log lines that are not valid UTF-8) and the legacy binary path (before
+// BinaryWriter/BinaryReader, see LegacyBinary.h).
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+#include <optional>
+#include "Serializable.h"
+#include "MapperInput.h"
+#include "Result.h"
+#include "ReducerInput.h"
+#include "LogRecord.h"
+#include "LegacyBinary.h"
+
+constexpr double min_total_ms = 100;            // of the runs of a measure, at least
+constexpr std::size_t max_runs = 100000;        // of a measure, at most
+const std::vector<double> percentiles = {50, 90, 99};
+constexpr std::size_t max_ptree_records = 100000;
+
+/**********
+ * Timing *
+ **********/
+// times of the runs of fun() in milliseconds, sorted, after a warmup run
+template<typename F>
+std::vector<double> measure_runs(F fun, unsigned int repetitions) {
+    fun();      // warmup
+    std::vector<double> times;
+    double total = 0;
+    while (times.size() < max_runs && (times.size() < repetitions || total < min_total_ms)) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = fun();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        total += times.back();
+    }       // result destroyed here, not measured
+    std::sort(times.begin(), times.end());
+    return times;
+}
+
+// nearest rank
+double percentile(const std::vector<double>& sorted_times, double p) {
+    auto rank = static_cast<std::size_t>(std::ceil(p / 100 * sorted_times.size()));
+    return sorted_times[std::max<std::size_t>(rank, 1) - 1];
+}
+
+// records/s at each percentile of the run times
+void print_throughput(const std::vector<double>& sorted_times, std::size_t n_records) {
+    for (double p : percentiles)
+        std::cout << "\t" << n_records / percentile(sorted_times, p) * 1000;
+}
+
+/***********
+ * Formats *
+ ***********/
+const std::vector<std::pair<BinaryFormat, std::string>> binary_formats = {
+        {BinaryFormat::SIZE_T, "size_t"},
+        {BinaryFormat::VARINT, "varint"},
+        {BinaryFormat::VARINT_FIXED, "varint+fixed"}
+};
+
+// decode_error: why the decoding failed, if it did
+void print_row(const std::string& format_name, std::size_t n_records, std::size_t n_bytes,
+               const std::vector<double>& encode_times, const std::vector<double>& decode_times,
+               const std::string& decode_error) {
+    std::cout << n_records << "\t" << format_name << "\t" << static_cast<double>(n_bytes) / n_records;
+    print_throughput(encode_times, n_records);
+    if (decode_error.empty())
+        print_throughput(decode_times, n_records);
+    else
+        std::cout << "\tfailed (" << decode_error << ")";
+    std::cout << std::endl;
+}
+
+// Encode runs on the records built by make_objs(), then decode runs on the encoded bytes. The records are freed
+// before decoding, so that there is only one copy of them in memory (10M records of MapperInput are 1.5 GB).
+// encode(objs) returns the bytes, decode(encoded, size) the records from the bytes followed by a '\0'.
+template<typename T, typename M, typename E, typename D>
+void benchmark_format(const std::string& name, const std::string& format_name, M make_objs, E encode, D decode,
+                      unsigned int repetitions) {
+    std::vector<T> objs = make_objs();
+    std::size_t n_records = objs.size();
+    std::vector<double> encode_times = measure_runs([&]() { return encode(objs); }, repetitions);
+    auto encoded = std::make_shared<std::vector<char>>(encode(objs));
+    std::size_t n_bytes = encoded->size();
+    encoded->push_back(0);
+    objs = std::vector<T>();
+
+    std::vector<double> decode_times;
+    std::string decode_error;
+    try {
+        decode_times = measure_runs([&]() { return decode(encoded, n_bytes); }, repetitions);
+        if (decode(encoded, n_bytes).size() != n_records)
+            std::cerr << "wrong number of records decoded for " << name << " (" << format_name << ")" << std::endl;
+    } catch (const pt::ptree_error& e) {
+        decode_error = e.what();    // ptree: e.g. log lines that are not valid UTF-8
+    }
+    print_row(format_name, n_records, n_bytes, encode_times, decode_times, decode_error);
+}
+
+template<typename T, typename M>
+void benchmark_formats(const std::string& name, M make_objs, std::size_t n_records, unsigned int repetitions) {
+    if (n_records <= max_ptree_records) {
+        benchmark_format<T>(name, "json ptree", make_objs,
+                [](const std::vector<T>& objs) { return serialize_json_ptree(objs); },
+                [](const std::shared_ptr<std::vector<char>>& encoded, std::size_t) {
+                    return deserialize_json_ptree<T>(std::shared_ptr<char[]>(encoded, encoded->data()));
+                }, repetitions);
+    }
+    benchmark_format<T>(name, "json", make_objs,
+            [](const std::vector<T>& objs) { return serialize_json(objs); },
+            [](const std::shared_ptr<std::vector<char>>& encoded, std::size_t) {
+                return deserialize_json<T>(std::shared_ptr<char[]>(encoded, encoded->data()));
+            }, repetitions);
+
+    benchmark_format<T>(name, "legacy", make_objs,
+            [](const std::vector<T>& objs) { return legacy_serialize(objs); },
+            [](const std::shared_ptr<std::vector<char>>& encoded, std::size_t) {
+                return legacy_deserialize<T>(encoded->data());
+            }, repetitions);
+
+    for (const auto& [format, format_name] : binary_formats) {
+        benchmark_format<T>(name, format_name, make_objs,
+                [format](const std::vector<T>& objs) { return serialize_binary(objs, format); },
+                [format](const std::shared_ptr<std::vector<char>>& encoded, std::size_t size) {
+                    BinaryReader reader(encoded->data(), size, format);
+                    return deserialize_binary<T>(reader);
+                }, repetitions);
+    }
+}
+
+// from 1 to max_records records: the first ones of the sequence built by make(i)
+template<typename T, typename F>
+void benchmark_type(const std::string& name, F make, std::size_t max_records, unsigned int repetitions) {
+    std::cout << name << " (records/s at p50, p90, p99 of the runs):\n";
+    std::cout << "records\tformat\tbytes/record\tencode p50\tencode p90\tencode p99\t"
+                 "decode p50\tdecode p90\tdecode p99\n";
+    for (std::size_t n_records = 1; n_records <= max_records; n_records *= 10) {
+        auto make_objs = [&make, n_records]() {
+            std::vector<T> objs;
+            objs.reserve(n_records);
+            for (std::size_t i=0; i<n_records; i++)
+                objs.push_back(make(i));
+            return objs;
+        };
+        benchmark_formats<T>(name, make_objs, n_records, repetitions);
+    }
+    std::cout << "\n";
+}
+
+int main(int argc, char **argv) {
+    std::size_t max_records = argc > 1 ? std::stoul(argv[1]) : 10000000;
+    unsigned int repetitions = argc > 2 ? std::stoul(argv[2]) : 5;
+
+    // records: built from the log lines, repeated up to max_records
+    std::ifstream input("localhost_access_log.2020.txt");
+    if (!input.is_open()) {
+        std::cerr << "File not found" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+    std::vector<MapperInput> lines;
+    MapperInput mapper_input;
+    while (input >> mapper_input)
+        lines.push_back(mapper_input);
+    auto record = [&lines](std::size_t i) {
+        std::optional<LogRecord> record = LogRecord::parse(lines[i % lines.size()].getInput());
+        if (!record)
+            std::exit(EXIT_FAILURE);
+        return *record;
+    };
+    auto ip = [&record](std::size_t i) { return std::string(record(i).ip); };
+    auto status = [&record](std::size_t i) { return std::string(record(i).status); };
+
+    benchmark_type<MapperInput>("MapperInput", [&lines](std::size_t i) {
+        return lines[i % lines.size()];
+    }, max_records, repetitions);
+
+    benchmark_type<Result<std::string,int>>("Result<string,int>", [&ip](std::size_t i) {
+        return Result<std::string,int>(ip(i), 1);
+    }, max_records, repetitions);
+
+    // as for the attacks: the accumulator is a list of the addresses seen so far (here, the last 4)
+    benchmark_type<ReducerInput<std::string,std::string,std::string>>("ReducerInput<string,string,string>",
+            [&ip, &status](std::size_t i) {
+        std::string acc;
+        for (std::size_t j = i >= 4 ? i - 4 : 0; j < i; j++)
+            acc += (acc.empty() ? "" : ", ") + ip(j);
+        return ReducerInput<std::string,std::string,std::string>(status(i), ip(i), acc);
+    }, max_records, repetitions);
+
+    return 0;
+}
@@ -4,8 +4,10 @@
 #include <thread>
 #include <unordered_map>
 #include <array>
+#include <charconv>
 #include "Jobs.h"
 #include "Results.h"
+#include "LogRecord.h"
 
 #define N_MAPPERS 10
 #define N_REDUCERS 10
@@ -63,9 +65,8 @@ int main() {
         while (true) {
             std::optional<std::string> line = line_jobs.get();
             if (!line) break;
-            std::istringstream iss(*line);
-            std::string ip;
-            if (iss >> ip) result_jobs.put(std::make_pair(ip, 1));
+            std::optional<LogRecord> record = LogRecord::parse(*line);
+            if (record) result_jobs.put(std::make_pair(std::string(record->ip), 1));
             else std::cerr << "invalid line" << std::endl;
         }
     };
@@ -93,11 +94,10 @@ int main() {
         while (true) {
             std::optional<std::string> line = line_jobs.get();
             if (!line) break;
-            std::istringstream iss(*line);
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), '[');
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), ':');
+            std::optional<LogRecord> record = LogRecord::parse(*line);
             int hour;
-            if (iss >> hour) result_jobs.put(std::make_pair(hour, 1));
+            if (record && std::from_chars(record->hour.data(), record->hour.data() + record->hour.size(), hour).ec ==
+                    std::errc()) result_jobs.put(std::make_pair(hour, 1));
             else std::cerr << "invalid line" << std::endl;
         }
     };
@@ -125,11 +125,8 @@ int main() {
         while (true) {
             std::optional<std::string> line = line_jobs.get();
             if (!line) break;
-            std::istringstream iss(*line);
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), ' ');
-            std::string url;
-            if (iss >> url) result_jobs.put(std::make_pair(url, 1));
+            std::optional<LogRecord> record = LogRecord::parse(*line);
+            if (record) result_jobs.put(std::make_pair(std::string(record->url), 1));
             else std::cerr << "invalid line" << std::endl;
         }
     };
@@ -157,32 +154,17 @@ int main() {
         while (true) {
             std::optional<std::string> line = line_jobs.get();
             if (!line) break;
-            std::istringstream iss(*line);
-            std::string ip;
+            std::optional<LogRecord> record = LogRecord::parse(*line);
             int code;
-
-            // IP address
-            iss >> ip;
-            if (!iss) {
-                std::cerr << "invalid line" << std::endl;
-                continue;
-            }
-
-            // code
-            iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
-            do {
-                iss.clear();
-                iss.ignore(std::numeric_limits<std::streamsize>::max(), '"');
-                iss >> code;
-            } while (iss.fail());   // there can be " in the URL
-            if (!iss) {
+            if (!record || std::from_chars(record->status.data(), record->status.data() + record->status.size(),
+                                           code).ec != std::errc()) {
                 std::cerr << "invalid line" << std::endl;
                 continue;
             }
 
             // add result
             if (code == 400 || code == 404 || code == 405)
-                result_jobs.put(std::make_pair(code, ip));
+                result_jobs.put(std::make_pair(code, std::string(record->ip)));
         }
     };
 